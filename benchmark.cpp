@@ -0,0 +1,364 @@
+#include "geometry.h"
+#include "geometry_index.h"
+#include "geometry_overlap.h"
+#include "geometry_small.h"
+#include "geometry_transform.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Throughput of the public geometry operations over collections of 10 to 10^8
+// rectangles. The benchmarks report:
+//  - items_per_second: rectangles (for index queries: queries) processed per second,
+//  - bytes_per_element: bytes of storage per rectangle in the collection,
+//  - alloc_bytes_per_element: heap bytes allocated per rectangle and iteration, which
+//    is 0 for operations that are meant to work in place (only for Rectangles).
+// Sweeps, the spatial index and coalesce keep O(n) scratch structures several times
+// the size of the input, so they stop at 10^7 to fit in memory.
+
+// Bytes allocated on the heap so far, including through the default memory resource.
+// The replacements are not inlined, so that the compiler does not pair allocations
+// made with operator new with the std::free below.
+static std::size_t allocated_bytes = 0;
+
+__attribute__((noinline)) void *operator new(std::size_t size) {
+    allocated_bytes += size;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void *operator new(std::size_t size, std::align_val_t align) {
+    allocated_bytes += size;
+    const std::size_t a = static_cast<std::size_t>(align);
+    if (void *p = std::aligned_alloc(a, (size + a - 1) / a * a + (size ? 0 : a)))
+        return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+    constexpr std::int64_t min_size = 10;
+    constexpr std::int64_t max_size = 100'000'000;
+    constexpr std::int64_t max_scratch_size = 10'000'000;
+
+    // A row of n unit squares, mergeable by merge_all.
+    Rectangles row(std::size_t n) {
+        Rectangles rects;
+        rects.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+            rects.emplace_back(1, 1, Position(static_cast<std::int32_t>(i), 0));
+        return rects;
+    }
+
+    // Unit squares tiling a square of about n cells, row after row.
+    Rectangles tiles(std::size_t n) {
+        std::int32_t side = 1;
+        while (std::size_t(side) * side < n)
+            ++side;
+        Rectangles rects;
+        rects.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+            rects.emplace_back(1, 1, Position(std::int32_t(i % side), std::int32_t(i / side)));
+        return rects;
+    }
+
+    // Runs body over a collection built by make, reporting the counters described above.
+    template <typename Make, typename Body>
+    void run(benchmark::State &state, Make make, Body body) {
+        const std::size_t n = static_cast<std::size_t>(state.range(0));
+        Rectangles rects = make(n);
+        const std::size_t before = allocated_bytes;
+        for (auto _ : state)
+            body(rects);
+        const double elements = double(state.iterations()) * double(n);
+        state.SetItemsProcessed(static_cast<std::int64_t>(elements));
+        state.counters["bytes_per_element"] = double(rects.capacity() * sizeof(Rectangle)) / n;
+        state.counters["alloc_bytes_per_element"] = double(allocated_bytes - before) /
+                                                    elements;
+    }
+} // namespace
+
+static void BM_TranslateInPlace(benchmark::State &state) {
+    run(state, row, [](Rectangles &rects) {
+        rects += Vector(1, -1);
+        rects += Vector(-1, 1);
+        benchmark::ClobberMemory();
+    });
+}
+
+static void BM_TranslateParallel(benchmark::State &state) {
+    run(state, row, [](Rectangles &rects) {
+        rects.translate(execution::par, Vector(1, -1));
+        rects.translate(execution::par, Vector(-1, 1));
+        benchmark::ClobberMemory();
+    });
+}
+
+static void BM_AddCopiedOperand(benchmark::State &state) {
+    run(state, row, [](const Rectangles &rects) {
+        const Rectangles shifted = rects + Vector(1, 1);
+        benchmark::DoNotOptimize(shifted.data());
+    });
+}
+
+static void BM_AddMovedOperand(benchmark::State &state) {
+    run(state, row, [](Rectangles &rects) {
+        rects = std::move(rects) + Vector(1, 1);
+        rects = Vector(-1, -1) + std::move(rects);
+        benchmark::DoNotOptimize(rects.data());
+    });
+}
+
+static void BM_AddChain(benchmark::State &state) {
+    run(state, row, [](const Rectangles &rects) {
+        const Rectangles shifted = rects + Vector(1, 1) + Vector(2, -3) + Vector(-3, 2);
+        benchmark::DoNotOptimize(shifted.data());
+    });
+}
+
+// operator+ on a copy of a collection of a few rectangles kept inline.
+static void BM_AddCopiedSmall(benchmark::State &state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const Rectangles source = row(n);
+    const SmallRectangles<> rects(source.begin(), source.end());
+    const std::size_t before = allocated_bytes;
+    for (auto _ : state) {
+        const SmallRectangles<> shifted = rects + Vector(1, 1);
+        benchmark::DoNotOptimize(shifted.data());
+    }
+    const double elements = double(state.iterations()) * double(n);
+    state.SetItemsProcessed(static_cast<std::int64_t>(elements));
+    state.counters["bytes_per_element"] = double(sizeof(rects)) / n;
+    state.counters["alloc_bytes_per_element"] = double(allocated_bytes - before) / elements;
+}
+
+static void BM_Copy(benchmark::State &state) {
+    run(state, row, [](const Rectangles &rects) {
+        const Rectangles copy = rects;
+        benchmark::DoNotOptimize(copy.data());
+    });
+}
+
+static void BM_Move(benchmark::State &state) {
+    run(state, row, [](Rectangles &rects) {
+        Rectangles moved = std::move(rects);
+        rects = std::move(moved);
+        benchmark::DoNotOptimize(rects.data());
+    });
+}
+
+static void BM_Equal(benchmark::State &state) {
+    const Rectangles other = row(state.range(0));
+    run(state, row, [&](const Rectangles &rects) { benchmark::DoNotOptimize(rects == other); });
+}
+
+static void BM_CompareFingerprints(benchmark::State &state) {
+    // Snapshots that differ in the last rectangle, told apart by their cached fingerprints.
+    Rectangles other = row(state.range(0));
+    other[other.size() - 1] = Rectangle(2, 2);
+    other.fingerprint();
+    run(state, row, [&](const Rectangles &rects) {
+        benchmark::DoNotOptimize(rects.fingerprint() == other.fingerprint());
+    });
+}
+
+static void BM_Reflection(benchmark::State &state) {
+    run(state, row, [](const Rectangles &rects) {
+        const Rectangles reflected = rects.reflection();
+        benchmark::DoNotOptimize(reflected.data());
+    });
+}
+
+static void BM_TransformApply(benchmark::State &state) {
+    // A rotation, a mirror and a translation, then their inverse.
+    const Transform there = Transform::rotation(1)
+                                .then(Transform::scaling(-1, 1))
+                                .then(Transform::translation({5, 7}));
+    const Transform back = Transform::translation({-5, -7})
+                               .then(Transform::scaling(-1, 1))
+                               .then(Transform::rotation(-1));
+    run(state, row, [&](Rectangles &rects) {
+        there.apply(rects);
+        back.apply(rects);
+        benchmark::ClobberMemory();
+    });
+}
+
+static void BM_MergeAll(benchmark::State &state) {
+    run(state, row, [](const Rectangles &rects) { benchmark::DoNotOptimize(merge_all(rects)); });
+}
+
+static void BM_MergeAllParallel(benchmark::State &state) {
+    run(state, row, [](const Rectangles &rects) {
+        benchmark::DoNotOptimize(merge_all(execution::par, rects));
+    });
+}
+
+static void BM_MergeAllTranslated(benchmark::State &state) {
+    run(state, row, [](const Rectangles &rects) {
+        benchmark::DoNotOptimize(merge_all(translated_view(rects, Vector(3, 4))));
+    });
+}
+
+// A row cut into chains of 8 rectangles, merged one by one and as a batch.
+static std::vector<std::size_t> chain_offsets(std::size_t n) {
+    std::vector<std::size_t> offsets;
+    for (std::size_t i = 0; i < n; i += 8)
+        offsets.push_back(i);
+    offsets.push_back(n);
+    return offsets;
+}
+
+static void BM_MergeChainsOneByOne(benchmark::State &state) {
+    const std::vector<std::size_t> offsets = chain_offsets(state.range(0));
+    run(state, row, [&](const Rectangles &rects) {
+        const RectanglesView view(rects);
+        for (std::size_t c = 0; c + 1 < offsets.size(); ++c)
+            benchmark::DoNotOptimize(
+                try_merge_all(view.subview(offsets[c], offsets[c + 1] - offsets[c])));
+    });
+}
+
+template <typename Policy>
+static void BM_MergeChains(benchmark::State &state) {
+    const std::vector<std::size_t> offsets = chain_offsets(state.range(0));
+    const std::size_t chains = offsets.size() - 1;
+    std::allocator<MergeResult> storage;
+    MergeResult *results = storage.allocate(chains);
+    run(state, row, [&](const Rectangles &rects) {
+        benchmark::DoNotOptimize(
+            try_merge_chains(Policy(), RectanglesView(rects), offsets.data(), chains, results));
+        benchmark::ClobberMemory();
+    });
+    storage.deallocate(results, chains);
+}
+
+static void BM_TryMergeAll(benchmark::State &state) {
+    run(state, row, [](const Rectangles &rects) {
+        benchmark::DoNotOptimize(try_merge_all(rects));
+    });
+}
+
+static void BM_ColumnarTranslate(benchmark::State &state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    ColumnarRectangles rects(row(n));
+    for (auto _ : state) {
+        rects += Vector(1, -1);
+        rects += Vector(-1, 1);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["bytes_per_element"] = 4 * sizeof(ColumnarRectangles::Lane);
+}
+
+static void BM_ColumnarEqual(benchmark::State &state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const ColumnarRectangles rects(row(n));
+    const ColumnarRectangles other = rects;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(rects == other);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["bytes_per_element"] = 4 * sizeof(ColumnarRectangles::Lane);
+}
+
+static void BM_Deduplicate(benchmark::State &state) {
+    // Includes the copy: tiles come row after row, so they are out of the x-major order.
+    run(state, tiles, [](const Rectangles &rects) {
+        Rectangles copy = rects;
+        copy.deduplicate();
+        benchmark::DoNotOptimize(copy.data());
+    });
+}
+
+static void BM_Coalesce(benchmark::State &state) {
+    run(state, tiles, [](const Rectangles &rects) {
+        const Rectangles merged = coalesce(rects);
+        benchmark::DoNotOptimize(merged.data());
+    });
+}
+
+static void BM_UnionArea(benchmark::State &state) {
+    run(state, tiles, [](const Rectangles &rects) { benchmark::DoNotOptimize(union_area(rects)); });
+}
+
+static void BM_AnyOverlap(benchmark::State &state) {
+    run(state, tiles,
+        [](const Rectangles &rects) { benchmark::DoNotOptimize(any_overlap(rects)); });
+}
+
+static void BM_IndexBuild(benchmark::State &state) {
+    run(state, tiles, [](const Rectangles &rects) {
+        const RectangleIndex index(rects);
+        benchmark::DoNotOptimize(index.size());
+    });
+}
+
+static void BM_IndexQueryWindow(benchmark::State &state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const Rectangles rects = tiles(n);
+    const RectangleIndex index(rects);
+    std::size_t out[64];
+    std::int32_t at = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.query_window(Rectangle(4, 4, {at % 1000, at % 997}), out, 64));
+        ++at;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+#define GEOMETRY_SIZES(Max) RangeMultiplier(10)->Range(min_size, Max)->Unit(benchmark::kMicrosecond)
+
+BENCHMARK(BM_TranslateInPlace)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_TranslateParallel)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_AddCopiedOperand)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_AddMovedOperand)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_AddChain)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_AddCopiedOperand)->Arg(1)->Arg(4)->Arg(8)->Arg(16);
+BENCHMARK(BM_AddCopiedSmall)->Arg(1)->Arg(4)->Arg(8)->Arg(16);
+BENCHMARK(BM_Copy)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_Move)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_Equal)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_CompareFingerprints)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_Reflection)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_TransformApply)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_MergeAll)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_MergeAllParallel)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_MergeAllTranslated)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_TryMergeAll)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_MergeChainsOneByOne)->GEOMETRY_SIZES(max_scratch_size);
+BENCHMARK(BM_MergeChains<execution::sequenced_policy>)->GEOMETRY_SIZES(max_scratch_size);
+BENCHMARK(BM_MergeChains<execution::parallel_policy>)->GEOMETRY_SIZES(max_scratch_size);
+BENCHMARK(BM_ColumnarTranslate)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_ColumnarEqual)->GEOMETRY_SIZES(max_size);
+BENCHMARK(BM_Deduplicate)->GEOMETRY_SIZES(max_scratch_size);
+BENCHMARK(BM_Coalesce)->GEOMETRY_SIZES(max_scratch_size);
+BENCHMARK(BM_UnionArea)->GEOMETRY_SIZES(max_scratch_size);
+BENCHMARK(BM_AnyOverlap)->GEOMETRY_SIZES(max_scratch_size);
+BENCHMARK(BM_IndexBuild)->GEOMETRY_SIZES(max_scratch_size);
+BENCHMARK(BM_IndexQueryWindow)->GEOMETRY_SIZES(max_scratch_size);
+
+BENCHMARK_MAIN();
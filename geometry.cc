@@ -1,127 +1,1032 @@
 #include "geometry.h"
+#include "geometry_checksum.h"
+#include "geometry_parallel.h"
 
-#define m_assert(expr, msg) assert(((void)(msg), (expr)))
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <unordered_map>
 
 namespace {
-    bool horizontal_merge_possible(const Rectangle &rect1, const Rectangle &rect2) {
-        return rect1.width() == rect2.width() &&
-               rect1.pos() + Vector(0, rect1.height()) == rect2.pos();
+    // Continues the left-to-right merge of the n rectangles at(0), ..., at(n - 1) from
+    // index first onwards, with ans holding the merge of everything before it.
+    template <typename Scalar, typename At>
+    BasicMergeResult<Scalar> merge_from(BasicRectangle<Scalar> ans, std::size_t n,
+                                        std::size_t first, At at) {
+        for (std::size_t i = first; i < n; ++i) {
+            const MergeError error = detail::merge_step(ans, at(i));
+            if (error != MergeError::none)
+                return {ans, i, error};
+        }
+        return {ans, BasicMergeResult<Scalar>::npos};
     }
 
-    bool vertical_merge_possible(const Rectangle &rect1, const Rectangle &rect2) {
-        return rect1.height() == rect2.height() &&
-               rect1.pos() + Vector(rect1.width(), 0) == rect2.pos();
+    template <typename Scalar>
+    BasicMergeResult<Scalar> merge_from(BasicRectangle<Scalar> ans,
+                                        BasicRectanglesView<Scalar> rects, std::size_t first) {
+        const BasicRectangle<Scalar> *r = rects.data();
+        return merge_from(ans, rects.size(), first, [r](std::size_t i) { return r[i]; });
+    }
+
+    // p + v computed without the overflow check, which is deferred as in overflow_bits.
+    template <typename Scalar>
+    BasicPosition<Scalar> wrapping_translate(const BasicPosition<Scalar> &p,
+                                             const BasicVector<Scalar> &v, Scalar &overflow) {
+        const Scalar x = detail::wrapping_add(p.x(), v.x());
+        const Scalar y = detail::wrapping_add(p.y(), v.y());
+        overflow |= detail::overflow_bits(p.x(), v.x(), x) | detail::overflow_bits(p.y(), v.y(), y);
+        return BasicPosition<Scalar>(x, y);
+    }
+
+    // Sort keys of a rectangle from the least to the most significant: height, width,
+    // y and x. Flipping the sign bit makes the unsigned order that of the coordinates.
+    template <typename Scalar, int Field>
+    std::make_unsigned_t<Scalar> sort_key(const BasicRectangle<Scalar> &r) {
+        using Unsigned = std::make_unsigned_t<Scalar>;
+        constexpr Unsigned sign = Unsigned(1) << (8 * sizeof(Scalar) - 1);
+        if constexpr (Field == 0)
+            return static_cast<Unsigned>(r.height()) ^ sign;
+        else if constexpr (Field == 1)
+            return static_cast<Unsigned>(r.width()) ^ sign;
+        else if constexpr (Field == 2)
+            return static_cast<Unsigned>(r.pos().y()) ^ sign;
+        else
+            return static_cast<Unsigned>(r.pos().x()) ^ sign;
+    }
+
+    // Calls f with the field as a std::integral_constant, so that the loops in f are
+    // compiled for each field.
+    template <typename F>
+    void with_field(int field, F f) {
+        switch (field) {
+        case 0:
+            return f(std::integral_constant<int, 0>());
+        case 1:
+            return f(std::integral_constant<int, 1>());
+        case 2:
+            return f(std::integral_constant<int, 2>());
+        default:
+            return f(std::integral_constant<int, 3>());
+        }
+    }
+
+    // A byte of a sort key: the field and the position of the byte in it.
+    struct Digit {
+        int field;
+        unsigned shift;
+    };
+
+    // One stable counting pass of the radix sort on digit d. offsets[b] starts as the
+    // number of keys whose digit is below b. The histogram of digit next is taken on
+    // the way, which saves the next pass a read of the whole collection.
+    template <typename Scalar, int Field, int NextField>
+    void radix_pass(const BasicRectangle<Scalar> *src, BasicRectangle<Scalar> *dst,
+                    std::size_t n, unsigned shift, std::size_t *offsets, unsigned next_shift,
+                    std::size_t *next_counts) {
+        for (std::size_t i = 0; i < n; ++i) {
+            const BasicRectangle<Scalar> r = src[i];
+            dst[offsets[(sort_key<Scalar, Field>(r) >> shift) & 0xff]++] = r;
+            ++next_counts[(sort_key<Scalar, NextField>(r) >> next_shift) & 0xff];
+        }
+    }
+
+    // LSD radix sort by bytes. Bytes that are the same in every key are found first and
+    // skipped: with small coordinates or equal sizes most of them are.
+    template <typename Scalar>
+    void radix_sort(typename BasicRectangles<Scalar>::storage_type &rects) {
+        using Unsigned = std::make_unsigned_t<Scalar>;
+        const std::size_t n = rects.size();
+        const BasicRectangle<Scalar> first = rects[0];
+        Unsigned differs[4] = {};
+        for (const BasicRectangle<Scalar> &r : rects) {
+            differs[0] |= sort_key<Scalar, 0>(r) ^ sort_key<Scalar, 0>(first);
+            differs[1] |= sort_key<Scalar, 1>(r) ^ sort_key<Scalar, 1>(first);
+            differs[2] |= sort_key<Scalar, 2>(r) ^ sort_key<Scalar, 2>(first);
+            differs[3] |= sort_key<Scalar, 3>(r) ^ sort_key<Scalar, 3>(first);
+        }
+        Digit digits[4 * sizeof(Scalar)];
+        std::size_t count = 0;
+        for (int field = 0; field < 4; ++field) {
+            for (unsigned shift = 0; shift < 8 * sizeof(Scalar); shift += 8) {
+                if ((differs[field] >> shift) & 0xff)
+                    digits[count++] = {field, shift};
+            }
+        }
+        if (count == 0)
+            return;
+
+        std::pmr::polymorphic_allocator<BasicRectangle<Scalar>> allocator =
+            rects.get_allocator();
+        BasicRectangle<Scalar> *const scratch = allocator.allocate(n);
+        BasicRectangle<Scalar> *src = rects.data(), *dst = scratch;
+        std::size_t counts[256] = {}, next_counts[256];
+        with_field(digits[0].field, [&](auto field) {
+            for (const BasicRectangle<Scalar> &r : rects)
+                ++counts[(sort_key<Scalar, field()>(r) >> digits[0].shift) & 0xff];
+        });
+        for (std::size_t d = 0; d < count; ++d) {
+            std::size_t sum = 0;
+            for (std::size_t &c : counts)
+                sum += std::exchange(c, sum);
+            std::fill(std::begin(next_counts), std::end(next_counts), 0);
+            const Digit next = d + 1 < count ? digits[d + 1] : digits[d];
+            with_field(digits[d].field, [&](auto field) {
+                with_field(next.field, [&](auto next_field) {
+                    radix_pass<Scalar, field(), next_field()>(src, dst, n, digits[d].shift,
+                                                               counts, next.shift, next_counts);
+                });
+            });
+            std::copy(std::begin(next_counts), std::end(next_counts), std::begin(counts));
+            std::swap(src, dst);
+        }
+        if (src != rects.data())
+            std::copy(src, src + n, rects.data());
+        allocator.deallocate(scratch, n);
+    }
+
+    // An edge shared by two mergeable rectangles: its start along the edge, its
+    // position across it and its length.
+    template <typename Scalar>
+    struct EdgeKey {
+        Scalar along, across, length;
+
+        bool operator==(const EdgeKey &other) const {
+            return along == other.along && across == other.across && length == other.length;
+        }
+    };
+
+    template <typename Scalar>
+    struct EdgeKeyHash {
+        std::size_t operator()(const EdgeKey<Scalar> &key) const {
+            std::uint64_t h = static_cast<std::uint64_t>(key.along);
+            h = h * 0x9e3779b97f4a7c15ULL + static_cast<std::uint64_t>(key.across);
+            h = h * 0x9e3779b97f4a7c15ULL + static_cast<std::uint64_t>(key.length);
+            h ^= h >> 31;
+            h *= 0xbf58476d1ce4e5b9ULL;
+            return static_cast<std::size_t>(h ^ (h >> 29));
+        }
+    };
+
+    // Coalesces rects in place, marking the absorbed ones dead, and reports whether some
+    // merge was skipped because it would overflow the coordinates. Every alive
+    // rectangle is indexed by its four edges; a rectangle whose edge matches the opposite
+    // edge of another is merged with it, and the merge is looked at again, until none
+    // matches. Every lookup either merges two rectangles or ends the visit of one, so
+    // the work is linear in the number of rectangles, whatever order they come in.
+    template <typename Scalar>
+    MergeError coalesce_in_place(typename BasicRectangles<Scalar>::storage_type &rects,
+                                 std::pmr::vector<char> &alive) {
+        using Key = EdgeKey<Scalar>;
+        using Index = std::pmr::unordered_map<Key, std::size_t, EdgeKeyHash<Scalar>>;
+        std::pmr::memory_resource *const resource = rects.get_allocator().resource();
+        // Bottom, top, left and right edges; top and right ones are missing where they
+        // overflow, as no rectangle can lie beyond them.
+        enum Side { bottom, top, left, right };
+        Index edges[] = {Index(resource), Index(resource), Index(resource), Index(resource)};
+        auto edge = [](const BasicRectangle<Scalar> &r, int side, Key &key) {
+            const BasicPosition<Scalar> p = r.pos();
+            switch (side) {
+            case bottom:
+                key = {p.x(), p.y(), r.width()};
+                return true;
+            case left:
+                key = {p.y(), p.x(), r.height()};
+                return true;
+            case top:
+                key = {p.x(), {}, r.width()};
+                return !__builtin_add_overflow(p.y(), r.height(), &key.across);
+            default:
+                key = {p.y(), {}, r.height()};
+                return !__builtin_add_overflow(p.x(), r.width(), &key.across);
+            }
+        };
+        auto index = [&](std::size_t i) {
+            Key key;
+            for (int side = bottom; side <= right; ++side) {
+                if (edge(rects[i], side, key))
+                    edges[side].emplace(key, i);
+            }
+        };
+        auto unindex = [&](std::size_t i) {
+            Key key;
+            for (int side = bottom; side <= right; ++side) {
+                if (!edge(rects[i], side, key))
+                    continue;
+                const auto it = edges[side].find(key);
+                if (it != edges[side].end() && it->second == i)
+                    edges[side].erase(it);
+            }
+        };
+        for (Index &e : edges)
+            e.reserve(rects.size());
+        for (std::size_t i = 0; i < rects.size(); ++i)
+            index(i);
+
+        // The side of a rectangle, the side of its neighbour that must match it, and
+        // whether the rectangle is the one that absorbs the neighbour (the lower or
+        // left one of the two, as in merge_all).
+        static constexpr struct {
+            Side mine, theirs;
+            bool absorbs;
+        } pairings[] = {{top, bottom, true},
+                        {right, left, true},
+                        {bottom, top, false},
+                        {left, right, false}};
+
+        MergeError error = MergeError::none;
+        std::pmr::vector<std::size_t> pending(resource);
+        pending.reserve(rects.size());
+        for (std::size_t i = rects.size(); i-- > 0;)
+            pending.push_back(i);
+        while (!pending.empty()) {
+            std::size_t i = pending.back();
+            pending.pop_back();
+            bool grown = alive[i];
+            while (grown) {
+                grown = false;
+                for (const auto &pairing : pairings) {
+                    Key key;
+                    if (!edge(rects[i], pairing.mine, key))
+                        continue;
+                    const auto it = edges[pairing.theirs].find(key);
+                    if (it == edges[pairing.theirs].end() || it->second == i)
+                        continue;
+                    const std::size_t lower = pairing.absorbs ? i : it->second;
+                    const std::size_t upper = pairing.absorbs ? it->second : i;
+                    BasicRectangle<Scalar> merged = rects[lower];
+                    const MergeError step = detail::merge_step(merged, rects[upper]);
+                    if (step != MergeError::none) {
+                        error = step;
+                        continue;
+                    }
+                    unindex(lower);
+                    unindex(upper);
+                    rects[lower] = merged;
+                    alive[upper] = false;
+                    index(lower);
+                    i = lower;
+                    grown = true;
+                    break;
+                }
+            }
+        }
+        return error;
+    }
+
+    // Records a merge of n rectangles in the statistics and passes its result on.
+    template <typename Scalar>
+    const BasicMergeResult<Scalar> &count_merge(const BasicMergeResult<Scalar> &result,
+                                                [[maybe_unused]] std::size_t n) {
+        GEOMETRY_STATS_ADD(merge_calls, 1);
+        GEOMETRY_STATS_ADD(merge_failures, !result);
+        GEOMETRY_STATS_ADD(merged_rectangles, n);
+        return result;
+    }
+
+    // In a successful left-to-right merge the accumulated rectangle always keeps the
+    // corner of rects[0], so each step is decided by where the next rectangle sits:
+    // rectangles above that corner (y != y0) are merged horizontally and grow the
+    // height, those level with it grow the width. This makes the total growth of a
+    // chunk an associative sum which chunks compute independently; a second pass
+    // then checks every step against the exact prefix sums.
+    template <typename Scalar>
+    struct MergeGrowth {
+        Scalar width = 0, height = 0;
+        bool overflow = false;
+    };
+
+    template <typename Scalar>
+    MergeGrowth<Scalar> merge_growth(BasicRectanglesView<Scalar> rects, Scalar y0,
+                                     std::size_t begin, std::size_t end) {
+        MergeGrowth<Scalar> g;
+        for (const BasicRectangle<Scalar> &r : rects.subview(begin, end - begin)) {
+            if (r.pos().y() == y0)
+                g.overflow |= __builtin_add_overflow(g.width, r.width(), &g.width);
+            else
+                g.overflow |= __builtin_add_overflow(g.height, r.height(), &g.height);
+        }
+        return g;
+    }
+
+    // Replays the steps in [begin, end) on a rectangle of the given size at corner,
+    // growing width and height as it goes. Returns the index of the first step the
+    // sequential fold would not perform as a plain merge (impossible merge or
+    // overflow), or end if there is none; the size is then the one before that step.
+    template <typename Scalar>
+    std::size_t replay_merge(BasicRectanglesView<Scalar> rects, BasicPosition<Scalar> corner,
+                             Scalar &width, Scalar &height, std::size_t begin, std::size_t end) {
+        const Scalar x0 = corner.x(), y0 = corner.y();
+        Scalar top = 0, right = 0, grown = 0;
+        for (std::size_t i = begin; i < end; ++i) {
+            const BasicRectangle<Scalar> &r = rects.data()[i];
+            bool horizontal = false, vertical = false;
+            if (r.width() == width) {
+                if (__builtin_add_overflow(y0, height, &top))
+                    return i;
+                horizontal = r.pos().x() == x0 && r.pos().y() == top;
+            }
+            if (!horizontal && r.height() == height) {
+                if (__builtin_add_overflow(x0, width, &right))
+                    return i;
+                vertical = r.pos().y() == y0 && r.pos().x() == right;
+            }
+            if (horizontal) {
+                if (__builtin_add_overflow(height, r.height(), &grown))
+                    return i;
+                height = grown;
+            } else if (vertical) {
+                if (__builtin_add_overflow(width, r.width(), &grown))
+                    return i;
+                width = grown;
+            } else {
+                return i;
+            }
+        }
+        return end;
+    }
+
+    // try_merge_chains of the chains [first, last). The steps are replayed on the raw
+    // rectangles; only a chain that stops early goes through the fold, which decides
+    // its failure (or overflow) exactly as try_merge_all does.
+    template <typename Scalar>
+    std::size_t merge_chains(BasicRectanglesView<Scalar> rects, const std::size_t *offsets,
+                             std::size_t first, std::size_t last,
+                             BasicMergeResult<Scalar> *results) {
+        std::size_t failures = 0;
+        for (std::size_t i = first; i < last; ++i) {
+            const std::size_t begin = offsets[i], end = offsets[i + 1];
+            const BasicRectangle<Scalar> head = rects.data()[begin];
+            Scalar width = head.width(), height = head.height();
+            const std::size_t stop = replay_merge(rects, head.pos(), width, height, begin + 1, end);
+            BasicMergeResult<Scalar> result{BasicRectangle<Scalar>(width, height, head.pos()),
+                                            BasicMergeResult<Scalar>::npos};
+            if (stop != end)
+                result = merge_from(result.merged, rects.subview(begin, end - begin), stop - begin);
+            ::new (static_cast<void *>(results + i)) BasicMergeResult<Scalar>(result);
+            failures += !result;
+        }
+        GEOMETRY_STATS_ADD(merge_calls, last - first);
+        GEOMETRY_STATS_ADD(merge_failures, failures);
+        GEOMETRY_STATS_ADD(merged_rectangles, last > first ? offsets[last] - offsets[first] : 0);
+        return failures;
+    }
+
+    // Terminates unless offsets delimit the given number of non-empty chains of rects.
+    void check_chain_offsets(const std::size_t *offsets, std::size_t chains, std::size_t size) {
+        for (std::size_t i = 0; i < chains; ++i) {
+            GEOMETRY_CHECK(offsets[i] <= offsets[i + 1], "Chain offsets must not decrease");
+            GEOMETRY_CHECK(offsets[i] != offsets[i + 1],
+                           "Merge failed, empty collection cannot be merged");
+        }
+        GEOMETRY_CHECK(offsets[chains] <= size, "Chain offsets out of bounds");
     }
 } // namespace
 
-XYObject::~XYObject() {
-};
+void detail::fail(const char *msg) noexcept {
+    std::fprintf(stderr, "geometry: %s\n", msg);
+    std::abort();
+}
 
-Vector::Vector(const Position &p) : XYObject{p.x(), p.y()} {
+MonotonicArena::MonotonicArena(std::size_t capacity, std::pmr::memory_resource *upstream)
+    : upstream_(upstream), capacity_(capacity),
+      buffer_(upstream->allocate(capacity, alignof(std::max_align_t))),
+      resource_(buffer_, capacity_, upstream_) {
 }
 
-Vector &Vector::operator+=(const Vector &other) {
-    x_ += other.x_;
-    y_ += other.y_;
-    return *this;
+MonotonicArena::~MonotonicArena() {
+    resource_.release();
+    upstream_->deallocate(buffer_, capacity_, alignof(std::max_align_t));
 }
 
-const Position &Position::origin() {
-    static Position o(0, 0);
+template <typename Scalar>
+const BasicPosition<Scalar> &BasicPosition<Scalar>::origin() {
+    static BasicPosition o(0, 0);
     return o;
 }
 
-Position &Position::operator+=(const Vector &v) {
-    x_ += v.x();
-    y_ += v.y();
-    return *this;
+template <typename Scalar>
+BasicRectangle<Scalar> &BasicRectangles<Scalar>::operator[](size_type n) {
+    GEOMETRY_ASSERT(n < rectangles_.size(), "Trying to access an element out of bounds.");
+    modified();
+    return rectangles_[n];
 }
 
-Rectangle::Rectangle(ScalarType width, ScalarType height, const Position position)
-    : width_(width), height_(height), left_bottom_corner(position) {
-    m_assert(height_ > 0 && width_ > 0, "Both dimensions of a rectangle must be positive.");
+template <typename Scalar>
+const BasicRectangle<Scalar> &BasicRectangles<Scalar>::operator[](size_type n) const {
+    GEOMETRY_ASSERT(n < rectangles_.size(), "Trying to access an element out of bounds.");
+    return rectangles_[n];
 }
 
-bool Rectangle::operator==(const Rectangle &other) const {
-    return width_ == other.width_ && height_ == other.height_ &&
-           left_bottom_corner == other.left_bottom_corner;
+template <typename Scalar>
+BasicRectangles<Scalar> &BasicRectangles<Scalar>::append(const BasicRectangles &other) {
+    modified();
+    if (&other == this) {
+        // Reallocation would invalidate the source range, so make room first.
+        const size_type n = rectangles_.size();
+        rectangles_.reserve(2 * n);
+        for (size_type i = 0; i < n; ++i)
+            rectangles_.push_back(rectangles_[i]);
+        return *this;
+    }
+    rectangles_.insert(rectangles_.end(), other.rectangles_.begin(), other.rectangles_.end());
+    return *this;
 }
 
-Rectangle &Rectangle::operator+=(const Vector &v) {
-    left_bottom_corner += v;
+template <typename Scalar>
+BasicRectangles<Scalar> &BasicRectangles<Scalar>::append(BasicRectangles &&other) {
+    modified();
+    other.modified();
+    // polymorphic_allocator does not propagate on swap, so buffers are exchanged only
+    // between collections on the same resource.
+    if (rectangles_.empty() && other.rectangles_.capacity() >= rectangles_.capacity() &&
+        resource() == other.resource())
+        rectangles_.swap(other.rectangles_);
+    else
+        append(static_cast<const BasicRectangles &>(other));
+    other.rectangles_.clear();
     return *this;
 }
 
-Position operator+(const Position &p, const Vector &v) {
-    return Position(p.x() + v.x(), p.y() + v.y());
+template <typename Scalar>
+BasicRectangles<Scalar> BasicRectangles<Scalar>::reflection() const {
+    BasicRectangles result(*this);
+    for (value_type &r : result)
+        r = r.reflection();
+    return result;
 }
 
-Position operator+(const Vector &v, const Position &p) {
-    return p + v;
+template <typename Scalar>
+void BasicRectangles<Scalar>::sort() {
+    // Below this size the histograms cost more than a comparison sort.
+    constexpr size_type radix_threshold = 512;
+    modified();
+    if (rectangles_.size() < radix_threshold)
+        std::sort(rectangles_.begin(), rectangles_.end());
+    else
+        radix_sort<Scalar>(rectangles_);
 }
 
-Rectangle operator+(const Rectangle &r, const Vector &v) {
-    return Rectangle(r.width(), r.height(), r.pos() + v);
+template <typename Scalar>
+void BasicRectangles<Scalar>::deduplicate() {
+    sort();
+    rectangles_.erase(std::unique(rectangles_.begin(), rectangles_.end()), rectangles_.end());
 }
 
-Rectangle operator+(const Vector &v, const Rectangle &r) {
-    return r + v;
+template <typename Scalar>
+std::uint64_t BasicRectangles<Scalar>::fingerprint() const {
+    std::uint64_t fingerprint = cached_fingerprint();
+    if (fingerprint == 0) {
+        fingerprint = detail::checksum(reinterpret_cast<const unsigned char *>(data()),
+                                       size() * sizeof(value_type));
+        // 0 marks a missing fingerprint, so it is not a valid one.
+        fingerprint += fingerprint == 0;
+        fingerprint_.store(fingerprint, std::memory_order_relaxed);
+    }
+    return fingerprint;
 }
 
-Rectangle &Rectangles::operator[](size_type n) {
-    m_assert(n < rectangles_.size(), "Trying to access an element out of bounds.");
-    return rectangles_[n];
+template <typename Scalar>
+bool BasicRectangles<Scalar>::operator==(const BasicRectangles &rects) const {
+    if (size() != rects.size())
+        return false;
+    return BasicRectanglesView<Scalar>(*this) == BasicRectanglesView<Scalar>(rects);
 }
 
-const Rectangle &Rectangles::operator[](size_type n) const {
-    m_assert(n < rectangles_.size(), "Trying to access an element out of bounds.");
-    return rectangles_[n];
+template <typename Scalar>
+BasicRectangles<Scalar> &BasicRectangles<Scalar>::operator+=(const BasicVector<Scalar> &v) {
+    translate(&v, 1);
+    return *this;
 }
 
-bool Rectangles::operator==(const Rectangles &rects) const {
-    if (rects.size() != this->size())
-        return false;
-    for (size_type i = 0; i < this->size(); ++i) {
-        if (!((*this)[i] == rects[i]))
-            return false;
+template <typename Scalar>
+BasicRectangles<Scalar> &BasicRectangles<Scalar>::translate(execution::sequenced_policy,
+                                                            const BasicVector<Scalar> &v) {
+    return *this += v;
+}
+
+template <typename Scalar>
+BasicRectangles<Scalar> &BasicRectangles<Scalar>::translate(execution::parallel_policy,
+                                                            const BasicVector<Scalar> &v) {
+    // Translation is bound by memory bandwidth, so below a few megabytes the threads
+    // cost more than they bring. Several chunks per thread leave work to steal.
+    constexpr std::size_t parallel_threshold = std::size_t(1) << 17;
+    constexpr std::size_t max_chunks = 64;
+    const std::size_t n = size();
+    const std::size_t chunks = detail::chunk_count(n, max_chunks, 4);
+    if (n < parallel_threshold || chunks < 2)
+        return *this += v;
+
+    GEOMETRY_STATS_TIME(translate_latency);
+    GEOMETRY_STATS_ADD(translate_calls, 1);
+    GEOMETRY_STATS_ADD(translated_rectangles, n);
+    modified();
+    value_type *const first = rectangles_.data();
+    Scalar overflow[max_chunks];
+    detail::parallel_for_chunks(chunks, chunks, [&](std::size_t c, std::size_t, std::size_t) {
+        const std::size_t begin = detail::line_aligned_bound(first, n, c, chunks);
+        const std::size_t end = detail::line_aligned_bound(first, n, c + 1, chunks);
+        overflow[c] = translate_range(first + begin, end - begin, &v, 1);
+    });
+    GEOMETRY_CHECK(*std::min_element(overflow, overflow + chunks) >= 0, "Coordinate overflow");
+    return *this;
+}
+
+template <typename Scalar>
+void BasicRectangles<Scalar>::translate(const BasicVector<Scalar> *offsets, std::size_t count) {
+    GEOMETRY_STATS_TIME(translate_latency);
+    GEOMETRY_STATS_ADD(translate_calls, 1);
+    GEOMETRY_STATS_ADD(translated_rectangles, rectangles_.size());
+    modified();
+    const Scalar overflow = translate_range(rectangles_.data(), rectangles_.size(), offsets, count);
+    GEOMETRY_CHECK(overflow >= 0, "Coordinate overflow");
+}
+
+template <typename Scalar>
+Scalar BasicRectangles<Scalar>::translate_range(value_type *first, std::size_t n,
+                                                const BasicVector<Scalar> *offsets,
+                                                std::size_t count) {
+    // Overflow is accumulated over the whole batch and checked once at the end,
+    // which keeps the loop free of per-element branches.
+    auto run = [first, n, offsets](auto steps) {
+        Scalar overflow = 0;
+        for (value_type *r = first; r != first + n; ++r) {
+            BasicPosition<Scalar> p = r->left_bottom_corner;
+            for (std::size_t k = 0; k < steps; ++k)
+                p = wrapping_translate(p, offsets[k], overflow);
+            r->left_bottom_corner = p;
+        }
+        return overflow;
+    };
+    // A single step, as in operator+=, gets a loop the compiler can vectorize.
+    return count == 1 ? run(std::integral_constant<std::size_t, 1>()) : run(count);
+}
+
+template <typename Scalar>
+BasicMergeResult<Scalar> detail::try_merge_translated(BasicRectanglesView<Scalar> rects,
+                                                      const BasicVector<Scalar> *offsets,
+                                                      std::size_t count) {
+    GEOMETRY_CHECK(!rects.empty(), "Merge failed, empty collection cannot be merged");
+    GEOMETRY_STATS_TIME(merge_latency);
+    auto at = [&](std::size_t i, Scalar &overflow) {
+        const BasicRectangle<Scalar> &r = rects.data()[i];
+        BasicPosition<Scalar> p = r.pos();
+        for (std::size_t k = 0; k < count; ++k)
+            p = wrapping_translate(p, offsets[k], overflow);
+        return BasicRectangle<Scalar>(r.width(), r.height(), p);
+    };
+    // A rectangle whose translation overflows ends the merge like one that cannot be
+    // merged; the first one has no merge before it, so it is reported untranslated.
+    Scalar overflow = 0;
+    BasicMergeResult<Scalar> result{at(0, overflow), BasicMergeResult<Scalar>::npos};
+    if (overflow < 0)
+        result = {rects[0], 0, MergeError::overflow};
+    for (std::size_t i = 1; result && i < rects.size(); ++i) {
+        const BasicRectangle<Scalar> r = at(i, overflow);
+        const MergeError error =
+            overflow < 0 ? MergeError::overflow : detail::merge_step(result.merged, r);
+        if (error != MergeError::none)
+            result = {result.merged, i, error};
+    }
+    count_merge(result, rects.size());
+    return result;
+}
+
+template <typename Scalar>
+bool detail::equal_translated(BasicRectanglesView<Scalar> rects, const BasicVector<Scalar> *offsets,
+                              std::size_t count, BasicRectanglesView<Scalar> other) {
+    // Every rectangle is translated, also past a difference or a size mismatch, so that
+    // overflow ends the program as it would when evaluating the expression.
+    const bool same_size = rects.size() == other.size();
+    bool equal = same_size;
+    Scalar overflow = 0;
+    for (std::size_t i = 0; i < rects.size(); ++i) {
+        const BasicRectangle<Scalar> &r = rects.data()[i];
+        BasicPosition<Scalar> p = r.pos();
+        for (std::size_t k = 0; k < count; ++k)
+            p = wrapping_translate(p, offsets[k], overflow);
+        if (same_size) {
+            const BasicRectangle<Scalar> &o = other.data()[i];
+            equal &= p == o.pos() && r.width() == o.width() && r.height() == o.height();
+        }
     }
-    return true;
+    GEOMETRY_CHECK(overflow >= 0, "Coordinate overflow");
+    return equal;
+}
+
+template <typename Scalar>
+typename BasicColumnarRectangles<Scalar>::reference &
+BasicColumnarRectangles<Scalar>::reference::operator=(const value_type &r) {
+    owner_->x_[n_] = r.pos().x();
+    owner_->y_[n_] = r.pos().y();
+    owner_->width_[n_] = r.width();
+    owner_->height_[n_] = r.height();
+    return *this;
+}
+
+template <typename Scalar>
+typename BasicColumnarRectangles<Scalar>::reference &
+BasicColumnarRectangles<Scalar>::reference::operator+=(const BasicVector<Scalar> &v) {
+    owner_->x_[n_] = detail::checked_add(owner_->x_[n_], v.x());
+    owner_->y_[n_] = detail::checked_add(owner_->y_[n_], v.y());
+    return *this;
+}
+
+template <typename Scalar>
+BasicColumnarRectangles<Scalar>::BasicColumnarRectangles(std::initializer_list<value_type> il) {
+    x_.reserve(il.size());
+    y_.reserve(il.size());
+    width_.reserve(il.size());
+    height_.reserve(il.size());
+    for (const value_type &r : il)
+        push_back(r);
+}
+
+template <typename Scalar>
+BasicColumnarRectangles<Scalar>::BasicColumnarRectangles(const BasicRectangles<Scalar> &rects) {
+    x_.reserve(rects.size());
+    y_.reserve(rects.size());
+    width_.reserve(rects.size());
+    height_.reserve(rects.size());
+    for (const value_type &r : rects)
+        push_back(r);
 }
 
-Rectangles &Rectangles::operator+=(const Vector &v) {
-    for (Rectangle &r : rectangles_)
-        r += v;
+template <typename Scalar>
+void BasicColumnarRectangles<Scalar>::push_back(const value_type &r) {
+    x_.push_back(r.pos().x());
+    y_.push_back(r.pos().y());
+    width_.push_back(r.width());
+    height_.push_back(r.height());
+}
+
+template <typename Scalar>
+typename BasicColumnarRectangles<Scalar>::reference
+BasicColumnarRectangles<Scalar>::operator[](size_type n) {
+    GEOMETRY_ASSERT(n < size(), "Trying to access an element out of bounds.");
+    return reference(this, n);
+}
+
+template <typename Scalar>
+BasicRectangle<Scalar> BasicColumnarRectangles<Scalar>::operator[](size_type n) const {
+    GEOMETRY_ASSERT(n < size(), "Trying to access an element out of bounds.");
+    return value_type(width_[n], height_[n], BasicPosition<Scalar>(x_[n], y_[n]));
+}
+
+template <typename Scalar>
+bool BasicColumnarRectangles<Scalar>::operator==(const BasicColumnarRectangles &rects) const {
+    // Each column is a contiguous array of integers, so these compile down to memcmp.
+    return x_ == rects.x_ && y_ == rects.y_ && width_ == rects.width_ &&
+           height_ == rects.height_;
+}
+
+template <typename Scalar>
+BasicColumnarRectangles<Scalar> &
+BasicColumnarRectangles<Scalar>::operator+=(const BasicVector<Scalar> &v) {
+    const Lane dx = v.x();
+    const Lane dy = v.y();
+    Lane *x = x_.data();
+    Lane *y = y_.data();
+    const size_type n = size();
+    Lane overflow = 0;
+    for (size_type i = 0; i < n; ++i) {
+        const Lane nx = detail::wrapping_add(x[i], dx);
+        overflow |= detail::overflow_bits(x[i], dx, nx);
+        x[i] = nx;
+    }
+    for (size_type i = 0; i < n; ++i) {
+        const Lane ny = detail::wrapping_add(y[i], dy);
+        overflow |= detail::overflow_bits(y[i], dy, ny);
+        y[i] = ny;
+    }
+    GEOMETRY_CHECK(overflow >= 0, "Coordinate overflow");
     return *this;
 }
 
-Rectangles operator+(Rectangles rects, const Vector &v) {
+template <typename Scalar>
+BasicColumnarRectangles<Scalar> operator+(BasicColumnarRectangles<Scalar> rects,
+                                          const BasicVector<Scalar> &v) {
     return std::move(rects += v);
 }
 
-Rectangles operator+(const Vector &v, Rectangles rects) {
+template <typename Scalar>
+BasicColumnarRectangles<Scalar> operator+(const BasicVector<Scalar> &v,
+                                          BasicColumnarRectangles<Scalar> rects) {
     return std::move(rects) + v;
 }
 
-Rectangle merge_horizontally(const Rectangle &r1, const Rectangle &r2) {
-    m_assert(horizontal_merge_possible(r1, r2), "Horizontal merge is impossible");
-    return Rectangle(r1.width(), r1.height() + r2.height(), r1.pos());
+template <typename Scalar>
+BasicMergeResult<Scalar> try_merge_all(BasicRectanglesView<Scalar> rects) {
+    GEOMETRY_CHECK(!rects.empty(), "Merge failed, empty collection cannot be merged");
+    GEOMETRY_STATS_TIME(merge_latency);
+    return count_merge(merge_from(rects[0], rects, 1), rects.size());
+}
+
+template <typename Scalar>
+BasicMergeResult<Scalar> try_merge_all(const BasicRectangles<Scalar> &rects) {
+    return try_merge_all(BasicRectanglesView<Scalar>(rects));
+}
+
+template <typename Scalar>
+BasicMergeResult<Scalar> try_merge_all(execution::sequenced_policy,
+                                       BasicRectanglesView<Scalar> rects) {
+    return try_merge_all(rects);
+}
+
+template <typename Scalar>
+BasicMergeResult<Scalar> try_merge_all(execution::sequenced_policy,
+                                       const BasicRectangles<Scalar> &rects) {
+    return try_merge_all(BasicRectanglesView<Scalar>(rects));
+}
+
+template <typename Scalar>
+BasicRectangle<Scalar> merge_all(BasicRectanglesView<Scalar> rects) {
+    return detail::merged_or_fail(try_merge_all(rects));
+}
+
+template <typename Scalar>
+BasicRectangle<Scalar> merge_all(const BasicRectangles<Scalar> &rects) {
+    return merge_all(BasicRectanglesView<Scalar>(rects));
+}
+
+template <typename Scalar>
+BasicRectangle<Scalar> merge_all(execution::sequenced_policy, BasicRectanglesView<Scalar> rects) {
+    return merge_all(rects);
+}
+
+template <typename Scalar>
+BasicRectangle<Scalar> merge_all(execution::sequenced_policy,
+                                 const BasicRectangles<Scalar> &rects) {
+    return merge_all(BasicRectanglesView<Scalar>(rects));
+}
+
+template <typename Scalar>
+BasicRectangle<Scalar> merge_all(execution::parallel_policy, BasicRectanglesView<Scalar> rects) {
+    return detail::merged_or_fail(try_merge_all(execution::par, rects));
 }
 
-Rectangle merge_vertically(const Rectangle &r1, const Rectangle &r2) {
-    m_assert(vertical_merge_possible(r1, r2), "Vertical merge is impossible");
-    return Rectangle(r1.width() + r2.width(), r1.height(), r1.pos());
+template <typename Scalar>
+BasicRectangle<Scalar> merge_all(execution::parallel_policy,
+                                 const BasicRectangles<Scalar> &rects) {
+    return merge_all(execution::par, BasicRectanglesView<Scalar>(rects));
 }
 
-Rectangle merge_all(const Rectangles &rects) {
-    m_assert(rects.size() > 0, "Merge failed, empty collection cannot be merged");
-    Rectangle ans = rects[0];
-    for (Rectangles::size_type i = 1; i < rects.size(); ++i) {
-        if (horizontal_merge_possible(ans, rects[i]))
-            ans = merge_horizontally(ans, rects[i]);
-        else if (vertical_merge_possible(ans, rects[i]))
-            ans = merge_vertically(ans, rects[i]);
+template <typename Scalar>
+BasicMergeResult<Scalar> try_merge_all(execution::parallel_policy,
+                                       const BasicRectangles<Scalar> &rects) {
+    return try_merge_all(execution::par, BasicRectanglesView<Scalar>(rects));
+}
+
+template <typename Scalar>
+BasicMergeResult<Scalar> try_merge_all(execution::parallel_policy,
+                                       BasicRectanglesView<Scalar> rects) {
+    GEOMETRY_CHECK(!rects.empty(), "Merge failed, empty collection cannot be merged");
+    const std::size_t n = rects.size();
+    const std::size_t chunks = n < 2 * detail::parallel_grain
+                                   ? 1
+                                   : detail::chunk_count(n - 1, detail::max_merge_chunks);
+    return detail::try_merge_all_chunked(rects, chunks);
+}
+
+template <typename Scalar>
+BasicMergeResult<Scalar> detail::try_merge_all_chunked(BasicRectanglesView<Scalar> rects,
+                                                       std::size_t chunks) {
+    GEOMETRY_CHECK(!rects.empty(), "Merge failed, empty collection cannot be merged");
+    GEOMETRY_STATS_TIME(merge_latency);
+    const std::size_t n = rects.size();
+    chunks = std::min({chunks, max_merge_chunks, n - 1});
+    if (chunks < 2)
+        return count_merge(merge_from(rects[0], rects, 1), n);
+
+    const BasicRectangle<Scalar> first = rects[0];
+    const BasicPosition<Scalar> corner = first.pos();
+    constexpr std::size_t max_chunks = max_merge_chunks;
+    std::size_t bounds[max_chunks + 1];
+    for (std::size_t c = 0; c <= chunks; ++c)
+        bounds[c] = 1 + (n - 1) * c / chunks;
+
+    // Pass 1: growth of every chunk of [1, n).
+    MergeGrowth<Scalar> growth[max_chunks];
+    detail::parallel_for_chunks(n - 1, chunks, [&](std::size_t c, std::size_t, std::size_t) {
+        growth[c] = merge_growth(rects, corner.y(), bounds[c], bounds[c + 1]);
+    });
+
+    // Exclusive prefix sums give the size accumulated before each chunk.
+    MergeGrowth<Scalar> state[max_chunks];
+    state[0] = {first.width(), first.height(), false};
+    for (std::size_t c = 1; c < chunks; ++c) {
+        const MergeGrowth<Scalar> &prev = state[c - 1];
+        state[c].overflow = prev.overflow || growth[c - 1].overflow ||
+                            __builtin_add_overflow(prev.width, growth[c - 1].width,
+                                                   &state[c].width) ||
+                            __builtin_add_overflow(prev.height, growth[c - 1].height,
+                                                   &state[c].height);
+    }
+
+    // Pass 2: every chunk replays its steps from its exact starting size. A chunk whose
+    // start overflowed is preceded by a chunk that fails, so it can be skipped.
+    std::size_t failure[max_chunks];
+    detail::parallel_for_chunks(n - 1, chunks, [&](std::size_t c, std::size_t, std::size_t) {
+        failure[c] = state[c].overflow ? bounds[c + 1]
+                                       : replay_merge(rects, corner, state[c].width,
+                                                      state[c].height, bounds[c], bounds[c + 1]);
+    });
+
+    for (std::size_t c = 0; c < chunks; ++c) {
+        // The sequential fold takes over at the first failing step, so that it fails
+        // exactly the way try_merge_all(rects) does.
+        if (failure[c] != bounds[c + 1])
+            return count_merge(
+                merge_from(BasicRectangle<Scalar>(state[c].width, state[c].height, corner),
+                           rects, failure[c]),
+                n);
+    }
+    return count_merge(
+        BasicMergeResult<Scalar>{
+            BasicRectangle<Scalar>(state[chunks - 1].width, state[chunks - 1].height, corner),
+            BasicMergeResult<Scalar>::npos},
+        n);
+}
+
+template <typename Scalar>
+std::size_t try_merge_chains(BasicRectanglesView<Scalar> rects, const std::size_t *offsets,
+                             std::size_t chains, BasicMergeResult<Scalar> *results) {
+    check_chain_offsets(offsets, chains, rects.size());
+    return merge_chains(rects, offsets, 0, chains, results);
+}
+
+template <typename Scalar>
+std::size_t try_merge_chains(execution::sequenced_policy, BasicRectanglesView<Scalar> rects,
+                             const std::size_t *offsets, std::size_t chains,
+                             BasicMergeResult<Scalar> *results) {
+    return try_merge_chains(rects, offsets, chains, results);
+}
+
+template <typename Scalar>
+std::size_t try_merge_chains(execution::parallel_policy, BasicRectanglesView<Scalar> rects,
+                             const std::size_t *offsets, std::size_t chains,
+                             BasicMergeResult<Scalar> *results) {
+    check_chain_offsets(offsets, chains, rects.size());
+    // Several runs per thread leave work to steal when chains differ in length.
+    constexpr std::size_t max_chunks = 64;
+    const std::size_t total = offsets[chains] - offsets[0];
+    const std::size_t chunks = std::min(detail::chunk_count(total, max_chunks, 4), chains);
+    if (chunks < 2)
+        return merge_chains(rects, offsets, 0, chains, results);
+
+    // Run c starts at the first chain starting at or after its share of the rectangles.
+    std::size_t bounds[max_chunks + 1];
+    bounds[0] = 0;
+    bounds[chunks] = chains;
+    for (std::size_t c = 1; c < chunks; ++c) {
+        const std::size_t target = offsets[0] + total * c / chunks;
+        bounds[c] = std::max<std::size_t>(
+            bounds[c - 1], std::lower_bound(offsets, offsets + chains, target) - offsets);
+    }
+    std::size_t failures[max_chunks];
+    detail::parallel_for_chunks(chunks, chunks, [&](std::size_t c, std::size_t, std::size_t) {
+        failures[c] = merge_chains(rects, offsets, bounds[c], bounds[c + 1], results);
+    });
+    return std::accumulate(failures, failures + chunks, std::size_t(0));
+}
+
+template <typename Scalar>
+void BasicStreamingMerger<Scalar>::push(const BasicRectangle<Scalar> &r) {
+    if (count_ == 0) {
+        state_.merged = r;
+    } else if (state_) {
+        state_.error = detail::merge_step(state_.merged, r);
+        if (state_.error != MergeError::none)
+            state_.failed_at = count_;
+    }
+    ++count_;
+}
+
+template <typename Scalar>
+void BasicStreamingMerger<Scalar>::push(BasicRectanglesView<Scalar> rects) {
+    if (rects.empty())
+        return;
+    if (count_ == 0) {
+        state_ = merge_from(rects[0], rects, 1);
+    } else if (state_) {
+        state_ = merge_from(state_.merged, rects, 0);
+        if (!state_)
+            state_.failed_at += count_;
+    }
+    count_ += rects.size();
+}
+
+template <typename Scalar>
+BasicMergeResult<Scalar> BasicStreamingMerger<Scalar>::result() const {
+    GEOMETRY_CHECK(count_ > 0, "Merge failed, empty collection cannot be merged");
+    return state_;
+}
+
+template <typename Scalar>
+void BasicIncrementalMerger<Scalar>::push(const BasicRectangle<Scalar> &r) {
+    if (prefixes_.empty()) {
+        prefixes_.push_back(r);
+    } else if (failed_at_ == npos) {
+        BasicRectangle<Scalar> merged = prefixes_.back();
+        error_ = detail::merge_step(merged, r);
+        if (error_ == MergeError::none)
+            prefixes_.push_back(merged);
         else
-            m_assert(false, "Merge failed, certain rectangles cannot be merged");
+            failed_at_ = count_;
+    }
+    ++count_;
+}
+
+template <typename Scalar>
+void BasicIncrementalMerger<Scalar>::pop() {
+    GEOMETRY_CHECK(count_ > 0, "Nothing to pop, the merger is empty");
+    --count_;
+    if (failed_at_ == count_) {
+        failed_at_ = npos;
+        error_ = MergeError::none;
+    } else if (failed_at_ == npos)
+        prefixes_.pop_back();
+}
+
+template <typename Scalar>
+BasicMergeResult<Scalar> BasicIncrementalMerger<Scalar>::result() const {
+    GEOMETRY_CHECK(count_ > 0, "Merge failed, empty collection cannot be merged");
+    return {prefixes_.back(), failed_at_, error_};
+}
+
+template <typename Scalar>
+BasicCoalesceResult<Scalar> try_coalesce(const BasicRectangles<Scalar> &rects) {
+    typename BasicRectangles<Scalar>::storage_type work(rects.begin(), rects.end(),
+                                                        rects.resource());
+    std::pmr::vector<char> alive(work.size(), true, rects.resource());
+    const MergeError error = coalesce_in_place<Scalar>(work, alive);
+
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < work.size(); ++i) {
+        if (alive[i])
+            work[kept++] = work[i];
     }
-    return ans;
+    work.erase(work.begin() + kept, work.end());
+    return {BasicRectangles<Scalar>(std::move(work)), error};
 }
+
+template <typename Scalar>
+BasicRectangles<Scalar> coalesce(const BasicRectangles<Scalar> &rects) {
+    BasicCoalesceResult<Scalar> result = try_coalesce(rects);
+    GEOMETRY_CHECK(result, "Coordinate overflow");
+    return std::move(result.rectangles);
+}
+
+#define GEOMETRY_INSTANTIATE(Scalar)                                                               \
+    template class BasicVector<Scalar>;                                                        \
+    template class BasicPosition<Scalar>;                                                      \
+    template class BasicRectangle<Scalar>;                                                     \
+    template class BasicRectangles<Scalar>;                                                    \
+    template class BasicColumnarRectangles<Scalar>;                                            \
+    template class BasicStreamingMerger<Scalar>;                                               \
+    template class BasicIncrementalMerger<Scalar>;                                             \
+    template BasicMergeResult<Scalar> detail::try_merge_translated(                            \
+        BasicRectanglesView<Scalar>, const BasicVector<Scalar> *, std::size_t);                \
+    template BasicMergeResult<Scalar> detail::try_merge_all_chunked(                           \
+        BasicRectanglesView<Scalar>, std::size_t);                                             \
+    template bool detail::equal_translated(BasicRectanglesView<Scalar>,                        \
+                                           const BasicVector<Scalar> *, std::size_t,           \
+                                           BasicRectanglesView<Scalar>);                       \
+    template BasicColumnarRectangles<Scalar> operator+(BasicColumnarRectangles<Scalar>,        \
+                                                       const BasicVector<Scalar> &);           \
+    template BasicColumnarRectangles<Scalar> operator+(const BasicVector<Scalar> &,            \
+                                                       BasicColumnarRectangles<Scalar>);       \
+    template BasicRectangle<Scalar> merge_all(const BasicRectangles<Scalar> &);                \
+    template BasicRectangle<Scalar> merge_all(execution::sequenced_policy,                     \
+                                              const BasicRectangles<Scalar> &);                \
+    template BasicRectangle<Scalar> merge_all(execution::parallel_policy,                      \
+                                              const BasicRectangles<Scalar> &);                \
+    template BasicMergeResult<Scalar> try_merge_all(const BasicRectangles<Scalar> &);          \
+    template BasicRectangles<Scalar> coalesce(const BasicRectangles<Scalar> &);                \
+    template BasicCoalesceResult<Scalar> try_coalesce(const BasicRectangles<Scalar> &);        \
+    template BasicMergeResult<Scalar> try_merge_all(execution::sequenced_policy,               \
+                                                    const BasicRectangles<Scalar> &);          \
+    template BasicMergeResult<Scalar> try_merge_all(execution::parallel_policy,                \
+                                                    const BasicRectangles<Scalar> &);          \
+    template BasicRectangle<Scalar> merge_all(BasicRectanglesView<Scalar>);                    \
+    template BasicRectangle<Scalar> merge_all(execution::sequenced_policy,                     \
+                                              BasicRectanglesView<Scalar>);                    \
+    template BasicRectangle<Scalar> merge_all(execution::parallel_policy,                      \
+                                              BasicRectanglesView<Scalar>);                    \
+    template BasicMergeResult<Scalar> try_merge_all(BasicRectanglesView<Scalar>);              \
+    template BasicMergeResult<Scalar> try_merge_all(execution::sequenced_policy,               \
+                                                    BasicRectanglesView<Scalar>);              \
+    template BasicMergeResult<Scalar> try_merge_all(execution::parallel_policy,                \
+                                                    BasicRectanglesView<Scalar>);              \
+    template std::size_t try_merge_chains(BasicRectanglesView<Scalar>, const std::size_t *,    \
+                                          std::size_t, BasicMergeResult<Scalar> *);            \
+    template std::size_t try_merge_chains(execution::sequenced_policy,                         \
+                                          BasicRectanglesView<Scalar>, const std::size_t *,    \
+                                          std::size_t, BasicMergeResult<Scalar> *);            \
+    template std::size_t try_merge_chains(execution::parallel_policy,                          \
+                                          BasicRectanglesView<Scalar>, const std::size_t *,    \
+                                          std::size_t, BasicMergeResult<Scalar> *);
+
+GEOMETRY_INSTANTIATE(std::int16_t)
+GEOMETRY_INSTANTIATE(std::int32_t)
+GEOMETRY_INSTANTIATE(std::int64_t)
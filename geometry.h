@@ -1,163 +1,1435 @@
 #ifndef GEOMETRY_GEOMETRY_H
 #define GEOMETRY_GEOMETRY_H
 
+#include "geometry_stats.h"
+
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <functional>
 #include <initializer_list>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-class XYObject {
+#define GEOMETRY_ASSERT(expr, msg) assert(((void)(msg), (expr)))
+// Unlike GEOMETRY_ASSERT, GEOMETRY_CHECK stays enabled when NDEBUG is defined.
+#define GEOMETRY_CHECK(expr, msg) ((expr) ? static_cast<void>(0) : ::detail::fail(msg))
+
+namespace detail {
+    // Reports a violated precondition and terminates the program.
+    [[noreturn]] void fail(const char *msg) noexcept;
+
+    template <typename Scalar>
+    constexpr Scalar checked_add(Scalar a, Scalar b) {
+        Scalar result{};
+        GEOMETRY_CHECK(!__builtin_add_overflow(a, b, &result), "Coordinate overflow");
+        return result;
+    }
+
+    template <typename Scalar>
+    constexpr Scalar checked_mul(Scalar a, Scalar b) {
+        Scalar result{};
+        GEOMETRY_CHECK(!__builtin_mul_overflow(a, b, &result), "Coordinate overflow");
+        return result;
+    }
+
+    // Two's complement addition without the overflow check. Together with
+    // overflow_bits it lets bulk loops defer the check to a single reduction.
+    template <typename Scalar>
+    constexpr Scalar wrapping_add(Scalar a, Scalar b) {
+        using Unsigned = std::make_unsigned_t<Scalar>;
+        return static_cast<Scalar>(static_cast<Unsigned>(a) + static_cast<Unsigned>(b));
+    }
+
+    // For sum == wrapping_add(a, b), the result is negative iff the addition overflowed.
+    // OR-ing the results over a batch gives one flag for the whole batch.
+    template <typename Scalar>
+    constexpr Scalar overflow_bits(Scalar a, Scalar b, Scalar sum) {
+        return static_cast<Scalar>((a ^ sum) & (b ^ sum));
+    }
+
+    // Finalizer of SplitMix64: every bit of h affects every bit of the result.
+    constexpr std::uint64_t hash_mix(std::uint64_t h) {
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebULL;
+        return h ^ (h >> 31);
+    }
+
+    // Hash of a pair of coordinates, continuing from seed. Coordinates of up to 32 bits
+    // are packed into a single word and mixed once.
+    template <typename Scalar>
+    constexpr std::uint64_t hash_pair(Scalar a, Scalar b, std::uint64_t seed = 0) {
+        using Unsigned = std::make_unsigned_t<Scalar>;
+        const std::uint64_t ua = static_cast<Unsigned>(a), ub = static_cast<Unsigned>(b);
+        if constexpr (sizeof(Scalar) <= 4)
+            return hash_mix(seed * 0x9e3779b97f4a7c15ULL + ((ua << 32) | ub));
+        else
+            return hash_mix(hash_mix(seed * 0x9e3779b97f4a7c15ULL + ua) + ub);
+    }
+} // namespace detail
+
+// All geometric types are templates over the coordinate type. Position, Vector,
+// Rectangle and Rectangles (see the aliases below) are the 32-bit instantiations;
+// the 16-bit and 64-bit ones are explicitly instantiated in geometry.cc as well.
+
+// Common base of Position and Vector. It is deliberately not polymorphic:
+// both derived classes are plain pairs of coordinates, so they stay trivially
+// copyable and can be stored and copied in bulk without a vtable pointer.
+template <typename Scalar>
+class BasicXYObject {
+    static_assert(std::is_integral_v<Scalar> && std::is_signed_v<Scalar>,
+                  "Coordinates must be of a signed integral type.");
+
   public:
-    using ScalarType = int_fast32_t;
+    using ScalarType = Scalar;
     using Coordinate = ScalarType;
 
-    XYObject(Coordinate x, Coordinate y) : x_(x), y_(y) {
+    constexpr BasicXYObject(Coordinate x, Coordinate y) : x_(x), y_(y) {
     }
-    XYObject() = delete;
-    XYObject(const XYObject &) = default;
-    XYObject &operator=(const XYObject &) = default;
-    virtual ~XYObject() = 0;
+    BasicXYObject() = delete;
+    BasicXYObject(const BasicXYObject &) = default;
+    BasicXYObject &operator=(const BasicXYObject &) = default;
 
-    Coordinate x() const {
+    constexpr Coordinate x() const {
         return x_;
     }
-    Coordinate y() const {
+    constexpr Coordinate y() const {
         return y_;
     }
 
   protected:
+    ~BasicXYObject() = default;
+
     Coordinate x_, y_;
 };
 
-class Position;
+template <typename Scalar>
+class BasicPosition;
 
-class Vector : public XYObject {
+template <typename Scalar>
+class BasicVector : public BasicXYObject<Scalar> {
   public:
-    Vector(Coordinate x, Coordinate y) : XYObject{x, y} {
+    using typename BasicXYObject<Scalar>::Coordinate;
+
+    constexpr BasicVector(Coordinate x, Coordinate y) : BasicXYObject<Scalar>{x, y} {
     };
-    explicit Vector(const Position &p);
+    explicit constexpr BasicVector(const BasicPosition<Scalar> &p);
 
-    Vector() = delete;
-    Vector(const Vector &) = default;
-    Vector &operator=(const Vector &) = default;
-    ~Vector() = default;
+    BasicVector() = delete;
+    BasicVector(const BasicVector &) = default;
+    BasicVector &operator=(const BasicVector &) = default;
+    ~BasicVector() = default;
 
-    Vector reflection() const {
-        return Vector(y_, x_);
+    constexpr BasicVector reflection() const {
+        return BasicVector(this->y_, this->x_);
     }
 
-    bool operator==(const Vector &other) const {
-        return x_ == other.x_ && y_ == other.y_;
+    constexpr bool operator==(const BasicVector &other) const {
+        return this->x_ == other.x_ && this->y_ == other.y_;
     };
 
-    Vector &operator+=(const Vector &other);
+    // Lexicographic, by x and then by y.
+    constexpr bool operator<(const BasicVector &other) const {
+        return this->x_ < other.x_ || (this->x_ == other.x_ && this->y_ < other.y_);
+    }
 
-    Vector operator+(const Vector &other) const {
-        return Vector(x_ + other.x_, y_ + other.y_);
+    constexpr BasicVector &operator+=(const BasicVector &other) {
+        this->x_ = detail::checked_add(this->x_, other.x_);
+        this->y_ = detail::checked_add(this->y_, other.y_);
+        return *this;
+    }
+
+    constexpr BasicVector operator+(const BasicVector &other) const {
+        return BasicVector(detail::checked_add(this->x_, other.x_),
+                           detail::checked_add(this->y_, other.y_));
     }
 };
 
-class Position : public XYObject {
+template <typename Scalar>
+class BasicPosition : public BasicXYObject<Scalar> {
   public:
-    Position(Coordinate x, Coordinate y) : XYObject{x, y} {
+    using typename BasicXYObject<Scalar>::Coordinate;
+
+    constexpr BasicPosition(Coordinate x, Coordinate y) : BasicXYObject<Scalar>{x, y} {
     };
-    explicit Position(const Vector &v) : XYObject{v.x(), v.y()} {
+    explicit constexpr BasicPosition(const BasicVector<Scalar> &v)
+        : BasicXYObject<Scalar>{v.x(), v.y()} {
     };
 
-    Position() = delete;
-    Position(const Position &) = default;
-    Position &operator=(const Position &) = default;
-    ~Position() = default;
+    BasicPosition() = delete;
+    BasicPosition(const BasicPosition &) = default;
+    BasicPosition &operator=(const BasicPosition &) = default;
+    ~BasicPosition() = default;
 
-    Position reflection() const {
-        return Position(y_, x_);
+    constexpr BasicPosition reflection() const {
+        return BasicPosition(this->y_, this->x_);
     }
 
-    bool operator==(const Position &other) const {
-        return x_ == other.x_ && y_ == other.y_;
+    constexpr bool operator==(const BasicPosition &other) const {
+        return this->x_ == other.x_ && this->y_ == other.y_;
     }
 
-    Position &operator+=(const Vector &v);
+    // Lexicographic, by x and then by y.
+    constexpr bool operator<(const BasicPosition &other) const {
+        return this->x_ < other.x_ || (this->x_ == other.x_ && this->y_ < other.y_);
+    }
+
+    constexpr BasicPosition &operator+=(const BasicVector<Scalar> &v) {
+        this->x_ = detail::checked_add(this->x_, v.x());
+        this->y_ = detail::checked_add(this->y_, v.y());
+        return *this;
+    }
 
-    static const Position &origin();
+    static const BasicPosition &origin();
 };
 
-class Rectangle {
-    using ScalarType = XYObject::ScalarType;
+template <typename Scalar>
+constexpr BasicVector<Scalar>::BasicVector(const BasicPosition<Scalar> &p)
+    : BasicXYObject<Scalar>{p.x(), p.y()} {
+}
 
+template <typename Scalar>
+class BasicRectangles;
+
+template <typename Scalar, typename Source>
+class BasicTranslatedRectangles;
+
+template <typename Scalar>
+class BasicRectangle {
+  public:
+    using ScalarType = Scalar;
+
+  private:
     ScalarType width_, height_;
-    Position left_bottom_corner;
+    BasicPosition<Scalar> left_bottom_corner;
 
   public:
-    Rectangle(ScalarType width, ScalarType height, Position position = {0, 0});
+    constexpr BasicRectangle(ScalarType width, ScalarType height,
+                             BasicPosition<Scalar> position = {0, 0})
+        : width_(width), height_(height), left_bottom_corner(position) {
+        GEOMETRY_ASSERT(height_ > 0 && width_ > 0,
+                        "Both dimensions of a rectangle must be positive.");
+    }
 
-    Rectangle() = delete;
-    Rectangle(const Rectangle &) = default;
-    Rectangle &operator=(const Rectangle &) = default;
-    ~Rectangle() = default;
+    BasicRectangle() = delete;
+    BasicRectangle(const BasicRectangle &) = default;
+    BasicRectangle &operator=(const BasicRectangle &) = default;
+    ~BasicRectangle() = default;
 
-    Rectangle reflection() const {
-        return Rectangle(height_, width_, left_bottom_corner.reflection());
+    constexpr BasicRectangle reflection() const {
+        return BasicRectangle(height_, width_, left_bottom_corner.reflection());
     }
 
-    ScalarType height() const {
+    constexpr ScalarType height() const {
         return height_;
     }
 
-    ScalarType width() const {
+    constexpr ScalarType width() const {
         return width_;
     }
 
-    Position pos() const {
+    constexpr BasicPosition<Scalar> pos() const {
         return left_bottom_corner;
     }
 
-    ScalarType area() const {
-        return width_ * height_;
+    constexpr ScalarType area() const {
+        return detail::checked_mul(width_, height_);
     }
 
-    bool operator==(const Rectangle &other) const;
-    Rectangle &operator+=(const Vector &v);
+    constexpr bool operator==(const BasicRectangle &other) const {
+        return width_ == other.width_ && height_ == other.height_ &&
+               left_bottom_corner == other.left_bottom_corner;
+    }
+
+    // Lexicographic, by position, width and height; BasicRectangles::sort orders by it.
+    constexpr bool operator<(const BasicRectangle &other) const {
+        if (left_bottom_corner.x() != other.left_bottom_corner.x() ||
+            left_bottom_corner.y() != other.left_bottom_corner.y())
+            return left_bottom_corner < other.left_bottom_corner;
+        return width_ < other.width_ || (width_ == other.width_ && height_ < other.height_);
+    }
+
+    constexpr BasicRectangle &operator+=(const BasicVector<Scalar> &v) {
+        left_bottom_corner += v;
+        return *this;
+    }
+
+    friend class BasicRectangles<Scalar>;
 };
 
-class Rectangles {
-    std::vector<Rectangle> rectangles_;
+// Execution policies selecting how bulk operations run, in the spirit of std::execution.
+namespace execution {
+    struct sequenced_policy {};
+    struct parallel_policy {};
+
+    inline constexpr sequenced_policy seq{};
+    inline constexpr parallel_policy par{};
+} // namespace execution
 
+// Collection of rectangles. Its storage comes from a std::pmr::memory_resource,
+// the default one unless stated otherwise. Copies and moves keep the resource of
+// the collection they come from, so everything derived from a collection built in
+// an arena (e.g. by operator+) stays in that arena. Copy assignment, as in the
+// std::pmr containers, keeps the resource of the collection assigned to; move
+// assignment takes over the buffer of the other collection together with its resource.
+//
+// The rectangles are stored contiguously and the iterators are plain pointers, so
+// the collection works with the standard (parallel) algorithms. Unlike operator[],
+// iteration does not check bounds.
+//
+// fingerprint() caches a checksum of the contents, so that snapshots whose
+// fingerprints differ can be told apart in O(1). Every non-const member function
+// drops the cached value, including those handing out pointers or references, but
+// changes made through a pointer or reference obtained before a later fingerprint()
+// leave it stale. operator== therefore always compares the rectangles themselves.
+template <typename Scalar>
+class BasicRectangles {
   public:
-    using size_type = std::vector<Rectangle>::size_type;
+    using value_type = BasicRectangle<Scalar>;
+    using storage_type = std::pmr::vector<value_type>;
+    using size_type = typename storage_type::size_type;
+    using iterator = value_type *;
+    using const_iterator = const value_type *;
 
-    Rectangles() = default;
-    Rectangles(const Rectangles &) = default;
-    Rectangles &operator=(const Rectangles &) = default;
-    Rectangles(Rectangles &&) noexcept = default;
-    Rectangles &operator=(Rectangles &&) noexcept = default;
-    ~Rectangles() = default;
+  private:
+    storage_type rectangles_;
+    // 0 until fingerprint() computes it; atomic, so that const collections can be
+    // fingerprinted from several threads at once.
+    mutable std::atomic<std::uint64_t> fingerprint_{0};
 
-    Rectangles(std::initializer_list<Rectangle> il) : rectangles_(il) {
+    std::uint64_t cached_fingerprint() const noexcept {
+        return fingerprint_.load(std::memory_order_relaxed);
     }
 
-    Rectangle &operator[](size_type n);
-    const Rectangle &operator[](size_type n) const;
+    void modified() noexcept {
+        fingerprint_.store(0, std::memory_order_relaxed);
+    }
+
+  public:
+    BasicRectangles() = default;
+    BasicRectangles(const BasicRectangles &other)
+        : rectangles_(other.rectangles_, other.rectangles_.get_allocator()),
+          fingerprint_(other.cached_fingerprint()) {
+        GEOMETRY_STATS_ADD(collection_copies, 1);
+    }
+    // Copies into storage from the resource of this collection.
+    BasicRectangles &operator=(const BasicRectangles &other) {
+        GEOMETRY_STATS_ADD(collection_copies, 1);
+        rectangles_ = other.rectangles_;
+        fingerprint_.store(other.cached_fingerprint(), std::memory_order_relaxed);
+        return *this;
+    }
+    BasicRectangles(BasicRectangles &&other) noexcept
+        : rectangles_(std::move(other.rectangles_)),
+          fingerprint_(other.cached_fingerprint()) {
+        GEOMETRY_STATS_ADD(collection_moves, 1);
+        other.modified();
+    }
+    BasicRectangles &operator=(BasicRectangles &&other) noexcept {
+        // Take over the buffer together with its resource, as the move constructor does.
+        GEOMETRY_STATS_ADD(collection_moves, 1);
+        if (this != &other) {
+            rectangles_.~storage_type();
+            ::new (static_cast<void *>(&rectangles_)) storage_type(std::move(other.rectangles_));
+            fingerprint_.store(other.cached_fingerprint(), std::memory_order_relaxed);
+            other.modified();
+        }
+        return *this;
+    }
+    ~BasicRectangles() = default;
+
+    explicit BasicRectangles(std::pmr::memory_resource *resource) : rectangles_(resource) {
+    }
+
+    BasicRectangles(const BasicRectangles &other, std::pmr::memory_resource *resource)
+        : rectangles_(other.rectangles_, resource), fingerprint_(other.cached_fingerprint()) {
+        GEOMETRY_STATS_ADD(collection_copies, 1);
+    }
+
+    BasicRectangles(std::initializer_list<value_type> il,
+                    std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : rectangles_(il, resource) {
+    }
+
+    // Copies the rectangles of [first, last), allocating once for forward iterators.
+    template <typename InputIt, typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+    BasicRectangles(InputIt first, InputIt last,
+                    std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : rectangles_(first, last, resource) {
+    }
+
+    // Adopts an existing buffer, with its resource, without copying it.
+    explicit BasicRectangles(storage_type &&rectangles) noexcept
+        : rectangles_(std::move(rectangles)) {
+    }
+
+    // Hands the buffer back, leaving the collection empty.
+    storage_type release() noexcept {
+        modified();
+        return std::move(rectangles_);
+    }
+
+    std::pmr::memory_resource *resource() const noexcept {
+        return rectangles_.get_allocator().resource();
+    }
+
+    value_type &operator[](size_type n);
+    const value_type &operator[](size_type n) const;
+
+    value_type *data() noexcept {
+        modified();
+        return rectangles_.data();
+    }
+    const value_type *data() const noexcept {
+        return rectangles_.data();
+    }
+
+    iterator begin() noexcept {
+        return data();
+    }
+    iterator end() noexcept {
+        return data() + size();
+    }
+    const_iterator begin() const noexcept {
+        return data();
+    }
+    const_iterator end() const noexcept {
+        return data() + size();
+    }
+    const_iterator cbegin() const noexcept {
+        return begin();
+    }
+    const_iterator cend() const noexcept {
+        return end();
+    }
 
     size_type size() const {
         return rectangles_.size();
     }
 
-    bool operator==(const Rectangles &) const;
-    Rectangles &operator+=(const Vector &);
+    bool empty() const noexcept {
+        return rectangles_.empty();
+    }
+
+    size_type capacity() const {
+        return rectangles_.capacity();
+    }
+
+    void reserve(size_type n) {
+        rectangles_.reserve(n);
+    }
+
+    void clear() noexcept {
+        modified();
+        rectangles_.clear();
+    }
+
+    void push_back(const value_type &r) {
+        modified();
+        rectangles_.push_back(r);
+    }
+
+    template <typename... Args>
+    value_type &emplace_back(Args &&...args) {
+        modified();
+        return rectangles_.emplace_back(std::forward<Args>(args)...);
+    }
+
+    BasicRectangles &append(const BasicRectangles &other);
+    // Takes over the buffer of other when this collection is empty and uses the same
+    // resource; copies the rectangles otherwise.
+    BasicRectangles &append(BasicRectangles &&other);
+
+    // Every rectangle reflected across x = y, as by BasicRectangle::reflection.
+    BasicRectangles reflection() const;
+
+    // Sorts the rectangles in ascending order of operator<. Large collections are
+    // sorted by a radix sort on the coordinates, with a scratch copy of the collection.
+    void sort();
+    // Sorts the rectangles and removes all but one of each group of equal ones.
+    void deduplicate();
+
+    // Checksum of the rectangles, computed at memory bandwidth on the first call and
+    // cached until the collection is modified. Equal collections have equal ones.
+    std::uint64_t fingerprint() const;
+
+    // Compares the bytes of the rectangles, after comparing the sizes. The fingerprints
+    // are not consulted, as they can be stale (see above).
+    bool operator==(const BasicRectangles &) const;
+    BasicRectangles &operator+=(const BasicVector<Scalar> &);
+
+    // operator+= with an execution policy. Under execution::par, collections above a
+    // threshold are split into chunks starting at cache-line boundaries, which are
+    // translated on the thread pool; the result is the same as with operator+=.
+    BasicRectangles &translate(execution::sequenced_policy, const BasicVector<Scalar> &v);
+    BasicRectangles &translate(execution::parallel_policy, const BasicVector<Scalar> &v);
+
+  private:
+    template <typename, typename>
+    friend class BasicTranslatedRectangles;
+
+    // Translates every rectangle by offsets[0], ..., offsets[count - 1] in turn, in a
+    // single pass, terminating if any step overflows.
+    void translate(const BasicVector<Scalar> *offsets, std::size_t count);
+
+    // The loop of translate over n rectangles, without the check: returns a negative
+    // value iff a step overflowed, as detail::overflow_bits does.
+    static Scalar translate_range(value_type *first, std::size_t n,
+                                  const BasicVector<Scalar> *offsets, std::size_t count);
 };
 
-Position operator+(const Position &, const Vector &);
-Position operator+(const Vector &, const Position &);
+// Read-only view of contiguous rectangles, in the spirit of std::span: a pointer
+// and a length, cheap to copy and to pass by value. It does not own the rectangles,
+// which must outlive it.
+template <typename Scalar>
+class BasicRectanglesView {
+  public:
+    using value_type = BasicRectangle<Scalar>;
+    using size_type = std::size_t;
+    using iterator = const value_type *;
+    using const_iterator = const value_type *;
+
+  private:
+    const value_type *data_ = nullptr;
+    size_type size_ = 0;
+
+  public:
+    constexpr BasicRectanglesView() = default;
+    constexpr BasicRectanglesView(const value_type *data, size_type size)
+        : data_(data), size_(size) {
+    }
+    BasicRectanglesView(const BasicRectangles<Scalar> &rects)
+        : data_(rects.data()), size_(rects.size()) {
+    }
+
+    constexpr const value_type &operator[](size_type n) const {
+        GEOMETRY_ASSERT(n < size_, "Trying to access an element out of bounds.");
+        return data_[n];
+    }
+
+    constexpr const value_type *data() const noexcept {
+        return data_;
+    }
+    constexpr iterator begin() const noexcept {
+        return data_;
+    }
+    constexpr iterator end() const noexcept {
+        return data_ + size_;
+    }
+    constexpr size_type size() const noexcept {
+        return size_;
+    }
+    constexpr bool empty() const noexcept {
+        return size_ == 0;
+    }
+
+    // The rectangles have no padding (see GEOMETRY_LAYOUT_CHECKS), so equal
+    // collections have equal bytes.
+    bool operator==(const BasicRectanglesView &other) const {
+        return size_ == other.size_ &&
+               (size_ == 0 || std::memcmp(data_, other.data_, size_ * sizeof(value_type)) == 0);
+    }
+
+    // The count rectangles starting at offset.
+    constexpr BasicRectanglesView subview(size_type offset, size_type count) const {
+        GEOMETRY_ASSERT(offset <= size_ && count <= size_ - offset,
+                        "Trying to access an element out of bounds.");
+        return BasicRectanglesView(data_ + offset, count);
+    }
+};
+
+template <typename Scalar>
+bool operator==(const BasicRectangles<Scalar> &rects, BasicRectanglesView<Scalar> view) {
+    return view == rects;
+}
+
+// Column-oriented (structure-of-arrays) storage for a collection of rectangles.
+// Every field lives in its own contiguous array of coordinate lanes, so translation
+// and comparison run as simple loops the compiler can vectorize. Elements are
+// accessed through proxy references instead of Rectangle &.
+template <typename Scalar>
+class BasicColumnarRectangles {
+  public:
+    using Lane = Scalar;
+    using value_type = BasicRectangle<Scalar>;
+    using size_type = typename std::vector<Lane>::size_type;
+
+    class reference {
+        BasicColumnarRectangles *owner_;
+        size_type n_;
+
+        reference(BasicColumnarRectangles *owner, size_type n) : owner_(owner), n_(n) {
+        }
+
+        friend class BasicColumnarRectangles;
+
+      public:
+        reference(const reference &) = default;
+        ~reference() = default;
+
+        reference &operator=(const value_type &r);
+        reference &operator=(const reference &other) {
+            return *this = static_cast<value_type>(other);
+        }
+
+        operator value_type() const {
+            return static_cast<const BasicColumnarRectangles &>(*owner_)[n_];
+        }
+
+        Scalar width() const {
+            return owner_->width_[n_];
+        }
+
+        Scalar height() const {
+            return owner_->height_[n_];
+        }
+
+        BasicPosition<Scalar> pos() const {
+            return BasicPosition<Scalar>(owner_->x_[n_], owner_->y_[n_]);
+        }
+
+        Scalar area() const {
+            return detail::checked_mul(width(), height());
+        }
+
+        bool operator==(const value_type &r) const {
+            return static_cast<value_type>(*this) == r;
+        }
+
+        reference &operator+=(const BasicVector<Scalar> &v);
+    };
+
+    BasicColumnarRectangles() = default;
+    BasicColumnarRectangles(const BasicColumnarRectangles &) = default;
+    BasicColumnarRectangles &operator=(const BasicColumnarRectangles &) = default;
+    BasicColumnarRectangles(BasicColumnarRectangles &&) noexcept = default;
+    BasicColumnarRectangles &operator=(BasicColumnarRectangles &&) noexcept = default;
+    ~BasicColumnarRectangles() = default;
+
+    BasicColumnarRectangles(std::initializer_list<value_type> il);
+    explicit BasicColumnarRectangles(const BasicRectangles<Scalar> &rects);
+
+    reference operator[](size_type n);
+    value_type operator[](size_type n) const;
+
+    size_type size() const {
+        return x_.size();
+    }
+
+    bool operator==(const BasicColumnarRectangles &) const;
+    BasicColumnarRectangles &operator+=(const BasicVector<Scalar> &);
+
+  private:
+    std::vector<Lane> x_, y_, width_, height_;
+
+    void push_back(const value_type &r);
+};
+
+using XYObject = BasicXYObject<std::int32_t>;
+using Vector = BasicVector<std::int32_t>;
+using Position = BasicPosition<std::int32_t>;
+using Rectangle = BasicRectangle<std::int32_t>;
+using Rectangles = BasicRectangles<std::int32_t>;
+using RectanglesView = BasicRectanglesView<std::int32_t>;
+using ColumnarRectangles = BasicColumnarRectangles<std::int32_t>;
+
+// The operations on single objects are constexpr, so that layouts known at compile
+// time can be computed by the compiler. Overflow and impossible merges, which
+// terminate at run time, make such computations fail to compile.
+template <typename Scalar>
+constexpr BasicPosition<Scalar> operator+(const BasicPosition<Scalar> &p,
+                                          const BasicVector<Scalar> &v) {
+    return BasicPosition<Scalar>(detail::checked_add(p.x(), v.x()),
+                                 detail::checked_add(p.y(), v.y()));
+}
+
+template <typename Scalar>
+constexpr BasicPosition<Scalar> operator+(const BasicVector<Scalar> &v,
+                                          const BasicPosition<Scalar> &p) {
+    return p + v;
+}
+
+template <typename Scalar>
+constexpr BasicRectangle<Scalar> operator+(const BasicRectangle<Scalar> &r,
+                                           const BasicVector<Scalar> &v) {
+    return BasicRectangle<Scalar>(r.width(), r.height(), r.pos() + v);
+}
+
+template <typename Scalar>
+constexpr BasicRectangle<Scalar> operator+(const BasicVector<Scalar> &v,
+                                           const BasicRectangle<Scalar> &r) {
+    return r + v;
+}
+
+template <typename Scalar>
+BasicColumnarRectangles<Scalar> operator+(BasicColumnarRectangles<Scalar>,
+                                          const BasicVector<Scalar> &);
+template <typename Scalar>
+BasicColumnarRectangles<Scalar> operator+(const BasicVector<Scalar> &,
+                                          BasicColumnarRectangles<Scalar>);
+
+namespace detail {
+    template <typename Scalar>
+    constexpr bool horizontal_merge_possible(const BasicRectangle<Scalar> &rect1,
+                                             const BasicRectangle<Scalar> &rect2) {
+        return rect1.width() == rect2.width() &&
+               rect1.pos() + BasicVector<Scalar>(0, rect1.height()) == rect2.pos();
+    }
+
+    template <typename Scalar>
+    constexpr bool vertical_merge_possible(const BasicRectangle<Scalar> &rect1,
+                                           const BasicRectangle<Scalar> &rect2) {
+        return rect1.height() == rect2.height() &&
+               rect1.pos() + BasicVector<Scalar>(rect1.width(), 0) == rect2.pos();
+    }
+} // namespace detail
+
+template <typename Scalar>
+constexpr BasicRectangle<Scalar> merge_horizontally(const BasicRectangle<Scalar> &r1,
+                                                    const BasicRectangle<Scalar> &r2) {
+    GEOMETRY_ASSERT(detail::horizontal_merge_possible(r1, r2), "Horizontal merge is impossible");
+    return BasicRectangle<Scalar>(r1.width(), detail::checked_add(r1.height(), r2.height()),
+                                  r1.pos());
+}
+
+template <typename Scalar>
+constexpr BasicRectangle<Scalar> merge_vertically(const BasicRectangle<Scalar> &r1,
+                                                  const BasicRectangle<Scalar> &r2) {
+    GEOMETRY_ASSERT(detail::vertical_merge_possible(r1, r2), "Vertical merge is impossible");
+    return BasicRectangle<Scalar>(detail::checked_add(r1.width(), r2.width()), r1.height(),
+                                  r1.pos());
+}
+
+// Why a merge stopped: the next rectangle does not share a whole edge with the merge
+// so far, or the merge (or its far edge) does not fit in the coordinate type.
+enum class MergeError { none, not_adjacent, overflow };
+
+namespace detail {
+    // One step of the left-to-right merge of merge_all: merges r into ans, or leaves ans
+    // as it was and reports why it could not. Unlike merge_horizontally and
+    // merge_vertically it never terminates, also not on overflowing coordinates.
+    template <typename Scalar>
+    constexpr MergeError merge_step(BasicRectangle<Scalar> &ans,
+                                    const BasicRectangle<Scalar> &r) {
+        const BasicPosition<Scalar> p = ans.pos();
+        Scalar edge{}, grown{};
+        bool overflow = false;
+        if (ans.width() == r.width()) {
+            if (__builtin_add_overflow(p.y(), ans.height(), &edge)) {
+                overflow = true;
+            } else if (r.pos() == BasicPosition<Scalar>(p.x(), edge)) {
+                if (__builtin_add_overflow(ans.height(), r.height(), &grown))
+                    return MergeError::overflow;
+                ans = BasicRectangle<Scalar>(ans.width(), grown, p);
+                return MergeError::none;
+            }
+        }
+        if (ans.height() == r.height()) {
+            if (__builtin_add_overflow(p.x(), ans.width(), &edge)) {
+                overflow = true;
+            } else if (r.pos() == BasicPosition<Scalar>(edge, p.y())) {
+                if (__builtin_add_overflow(ans.width(), r.width(), &grown))
+                    return MergeError::overflow;
+                ans = BasicRectangle<Scalar>(grown, ans.height(), p);
+                return MergeError::none;
+            }
+        }
+        return overflow ? MergeError::overflow : MergeError::not_adjacent;
+    }
+} // namespace detail
+
+// The default argument lets merge_all({rect1, rect2, ...}) pick the 32-bit types.
+template <typename Scalar = std::int32_t>
+BasicRectangle<Scalar> merge_all(const BasicRectangles<Scalar> &);
+
+// Outcome of try_merge_all. On success merged is the merge of the whole collection;
+// otherwise failed_at is the index of the first rectangle that could not be merged,
+// error says why and merged is the merge of all rectangles before it.
+template <typename Scalar>
+struct BasicMergeResult {
+    using size_type = typename BasicRectangles<Scalar>::size_type;
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    BasicRectangle<Scalar> merged;
+    size_type failed_at;
+    MergeError error = MergeError::none;
+
+    constexpr explicit operator bool() const {
+        return failed_at == npos;
+    }
+};
+
+using MergeResult = BasicMergeResult<std::int32_t>;
+
+namespace detail {
+    // The merged rectangle of a successful merge; terminates, as merge_all does, otherwise.
+    template <typename Scalar>
+    constexpr BasicRectangle<Scalar> merged_or_fail(const BasicMergeResult<Scalar> &result) {
+        GEOMETRY_CHECK(result.error != MergeError::overflow, "Coordinate overflow");
+        GEOMETRY_CHECK(result, "Merge failed, certain rectangles cannot be merged");
+        return result.merged;
+    }
+} // namespace detail
+
+// Collection of at most Capacity rectangles stored in the object itself, for layouts
+// that are fixed at compile time: it can be built, translated and merged in constant
+// expressions, where a merge that fails is a compile error. Exceeding the capacity
+// terminates (or does not compile).
+template <typename Scalar, std::size_t Capacity>
+class BasicFixedRectangles {
+    static_assert(Capacity > 0, "A fixed collection needs room for a rectangle.");
+
+  public:
+    using value_type = BasicRectangle<Scalar>;
+    using size_type = std::size_t;
+    using iterator = value_type *;
+    using const_iterator = const value_type *;
+
+  private:
+    // Rectangles cannot be default-constructed, so unused slots hold unit squares.
+    value_type rectangles_[Capacity];
+    size_type size_ = 0;
+
+    template <std::size_t... I>
+    constexpr explicit BasicFixedRectangles(std::index_sequence<I...>)
+        : rectangles_{((void)I, value_type(1, 1))...} {
+    }
+
+  public:
+    constexpr BasicFixedRectangles() : BasicFixedRectangles(std::make_index_sequence<Capacity>()) {
+    }
+
+    constexpr BasicFixedRectangles(std::initializer_list<value_type> il)
+        : BasicFixedRectangles() {
+        GEOMETRY_CHECK(il.size() <= Capacity, "Too many rectangles for a fixed collection");
+        for (const value_type &r : il)
+            rectangles_[size_++] = r;
+    }
+
+    constexpr value_type &operator[](size_type n) {
+        GEOMETRY_ASSERT(n < size_, "Trying to access an element out of bounds.");
+        return rectangles_[n];
+    }
+    constexpr const value_type &operator[](size_type n) const {
+        GEOMETRY_ASSERT(n < size_, "Trying to access an element out of bounds.");
+        return rectangles_[n];
+    }
+
+    constexpr value_type *data() noexcept {
+        return rectangles_;
+    }
+    constexpr const value_type *data() const noexcept {
+        return rectangles_;
+    }
+    constexpr iterator begin() noexcept {
+        return rectangles_;
+    }
+    constexpr iterator end() noexcept {
+        return rectangles_ + size_;
+    }
+    constexpr const_iterator begin() const noexcept {
+        return rectangles_;
+    }
+    constexpr const_iterator end() const noexcept {
+        return rectangles_ + size_;
+    }
+
+    constexpr size_type size() const noexcept {
+        return size_;
+    }
+    constexpr bool empty() const noexcept {
+        return size_ == 0;
+    }
+    static constexpr size_type capacity() noexcept {
+        return Capacity;
+    }
+
+    constexpr void push_back(const value_type &r) {
+        GEOMETRY_CHECK(size_ < Capacity, "Too many rectangles for a fixed collection");
+        rectangles_[size_++] = r;
+    }
+
+    constexpr BasicRectanglesView<Scalar> view() const noexcept {
+        return BasicRectanglesView<Scalar>(rectangles_, size_);
+    }
+    constexpr operator BasicRectanglesView<Scalar>() const noexcept {
+        return view();
+    }
+
+    constexpr BasicFixedRectangles &operator+=(const BasicVector<Scalar> &v) {
+        for (size_type i = 0; i < size_; ++i)
+            rectangles_[i] += v;
+        return *this;
+    }
+
+    constexpr bool operator==(const BasicFixedRectangles &other) const {
+        if (size_ != other.size_)
+            return false;
+        for (size_type i = 0; i < size_; ++i) {
+            if (!(rectangles_[i] == other.rectangles_[i]))
+                return false;
+        }
+        return true;
+    }
+};
+
+template <std::size_t Capacity>
+using FixedRectangles = BasicFixedRectangles<std::int32_t, Capacity>;
+
+template <typename Scalar, std::size_t Capacity>
+constexpr BasicFixedRectangles<Scalar, Capacity>
+operator+(BasicFixedRectangles<Scalar, Capacity> rects, const BasicVector<Scalar> &v) {
+    rects += v;
+    return rects;
+}
+
+template <typename Scalar, std::size_t Capacity>
+constexpr BasicFixedRectangles<Scalar, Capacity>
+operator+(const BasicVector<Scalar> &v, BasicFixedRectangles<Scalar, Capacity> rects) {
+    rects += v;
+    return rects;
+}
+
+template <typename Scalar, std::size_t Capacity>
+constexpr BasicMergeResult<Scalar>
+try_merge_all(const BasicFixedRectangles<Scalar, Capacity> &rects) {
+    GEOMETRY_CHECK(!rects.empty(), "Merge failed, empty collection cannot be merged");
+    BasicRectangle<Scalar> ans = rects[0];
+    for (std::size_t i = 1; i < rects.size(); ++i) {
+        if (const MergeError error = detail::merge_step(ans, rects[i]); error != MergeError::none)
+            return {ans, i, error};
+    }
+    return {ans, BasicMergeResult<Scalar>::npos};
+}
+
+template <typename Scalar, std::size_t Capacity>
+constexpr BasicRectangle<Scalar> merge_all(const BasicFixedRectangles<Scalar, Capacity> &rects) {
+    return detail::merged_or_fail(try_merge_all(rects));
+}
+
+// merge_all over rectangles that arrive one at a time or in batches, e.g. from a
+// generator or a file read piece by piece (see try_merge_file in geometry_io.h). Only
+// the running merge is kept, so memory use does not depend on the length of the input.
+// After the first rectangle that cannot be merged the rest are only counted, and
+// result() reports the same as try_merge_all of the whole sequence would.
+template <typename Scalar>
+class BasicStreamingMerger {
+  public:
+    using size_type = typename BasicMergeResult<Scalar>::size_type;
+
+  private:
+    BasicMergeResult<Scalar> state_{BasicRectangle<Scalar>(1, 1), BasicMergeResult<Scalar>::npos};
+    size_type count_ = 0;
+
+  public:
+    BasicStreamingMerger() = default;
+
+    void push(const BasicRectangle<Scalar> &r);
+    void push(BasicRectanglesView<Scalar> rects);
+
+    template <typename InputIt>
+    void push(InputIt first, InputIt last) {
+        for (; first != last; ++first)
+            push(static_cast<const BasicRectangle<Scalar> &>(*first));
+    }
+
+    // Number of rectangles pushed so far.
+    size_type count() const {
+        return count_;
+    }
+
+    // Whether all rectangles so far could be merged.
+    explicit operator bool() const {
+        return static_cast<bool>(state_);
+    }
+
+    // At least one rectangle must have been pushed.
+    BasicMergeResult<Scalar> result() const;
+};
+
+using StreamingMerger = BasicStreamingMerger<std::int32_t>;
+
+// merge_all over a sequence edited at its end, e.g. a chain built interactively.
+// The merge of every prefix is kept, so that push and pop cost O(1) (amortized) and
+// result() always reports the same as try_merge_all of the current sequence. After a
+// rectangle that cannot be merged, later ones are only counted until it is popped.
+template <typename Scalar>
+class BasicIncrementalMerger {
+  public:
+    using size_type = typename BasicMergeResult<Scalar>::size_type;
+
+    static constexpr size_type npos = BasicMergeResult<Scalar>::npos;
+
+  private:
+    // prefixes_[i] is the merge of the first i + 1 rectangles, up to the first failure.
+    std::pmr::vector<BasicRectangle<Scalar>> prefixes_;
+    size_type failed_at_ = npos;
+    MergeError error_ = MergeError::none;
+    size_type count_ = 0;
+
+  public:
+    explicit BasicIncrementalMerger(
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : prefixes_(resource) {
+    }
+
+    void push(const BasicRectangle<Scalar> &r);
+
+    // Removes the rectangle pushed last; there must be one.
+    void pop();
+
+    void reserve(size_type n) {
+        prefixes_.reserve(n);
+    }
+
+    void clear() noexcept {
+        prefixes_.clear();
+        failed_at_ = npos;
+        error_ = MergeError::none;
+        count_ = 0;
+    }
+
+    size_type size() const noexcept {
+        return count_;
+    }
+
+    bool empty() const noexcept {
+        return count_ == 0;
+    }
+
+    // Whether all rectangles so far could be merged.
+    explicit operator bool() const noexcept {
+        return failed_at_ == npos;
+    }
+
+    // There must be at least one rectangle.
+    BasicMergeResult<Scalar> result() const;
+};
+
+using IncrementalMerger = BasicIncrementalMerger<std::int32_t>;
+
+// Like merge_all, but reports a rectangle that cannot be merged, also because the merge
+// would overflow the coordinates, instead of terminating. The collection must not be
+// empty.
+template <typename Scalar = std::int32_t>
+BasicMergeResult<Scalar> try_merge_all(const BasicRectangles<Scalar> &);
+
+// Merges rectangles given in any order: whenever one rectangle can be merged with
+// another by merge_horizontally or merge_vertically, the two are replaced by their
+// merge, until no two remaining rectangles can be merged. Neighbours are found by
+// hashing edges, so the expected time is linear in the number of rectangles.
+// Surviving rectangles keep the relative order of the inputs they grew from. The
+// result and all scratch space come from the memory resource of the input.
+// Terminates if a merge would overflow the coordinates.
+template <typename Scalar = std::int32_t>
+BasicRectangles<Scalar> coalesce(const BasicRectangles<Scalar> &);
+
+// Outcome of try_coalesce: the coalesced rectangles, and MergeError::overflow if some
+// merges were left out because they would overflow the coordinates.
+template <typename Scalar>
+struct BasicCoalesceResult {
+    BasicRectangles<Scalar> rectangles;
+    MergeError error = MergeError::none;
+
+    explicit operator bool() const {
+        return error == MergeError::none;
+    }
+};
+
+using CoalesceResult = BasicCoalesceResult<std::int32_t>;
+
+// Like coalesce, but leaves out the merges that would overflow the coordinates and
+// reports them, instead of terminating.
+template <typename Scalar = std::int32_t>
+BasicCoalesceResult<Scalar> try_coalesce(const BasicRectangles<Scalar> &);
+
+// Monotonic arena for short-lived collections: allocations bump a pointer through a
+// buffer reserved up front, and reset() makes the whole buffer available again.
+// Only when the buffer is exhausted does it fall back to the upstream resource.
+class MonotonicArena {
+    std::pmr::memory_resource *upstream_;
+    std::size_t capacity_;
+    void *buffer_;
+    std::pmr::monotonic_buffer_resource resource_;
+
+  public:
+    explicit MonotonicArena(std::size_t capacity, std::pmr::memory_resource *upstream =
+                                                      std::pmr::get_default_resource());
+    MonotonicArena(const MonotonicArena &) = delete;
+    MonotonicArena &operator=(const MonotonicArena &) = delete;
+    ~MonotonicArena();
+
+    std::pmr::memory_resource *resource() noexcept {
+        return &resource_;
+    }
+
+    // Frees everything allocated from the arena at once. Collections using it must
+    // not be used afterwards.
+    void reset() noexcept {
+        resource_.release();
+    }
+};
+
+template <typename Scalar = std::int32_t>
+BasicRectangle<Scalar> merge_all(execution::sequenced_policy, const BasicRectangles<Scalar> &);
+// Splits the collection into chunks merged on separate threads. The result, and
+// the behaviour on rectangles that cannot be merged, are those of merge_all(rects).
+template <typename Scalar = std::int32_t>
+BasicRectangle<Scalar> merge_all(execution::parallel_policy, const BasicRectangles<Scalar> &);
+
+template <typename Scalar = std::int32_t>
+BasicMergeResult<Scalar> try_merge_all(execution::sequenced_policy,
+                                       const BasicRectangles<Scalar> &);
+template <typename Scalar = std::int32_t>
+BasicMergeResult<Scalar> try_merge_all(execution::parallel_policy,
+                                       const BasicRectangles<Scalar> &);
+
+// The merges of rectangles that are not held in a BasicRectangles, e.g. a mapped file.
+template <typename Scalar>
+BasicRectangle<Scalar> merge_all(BasicRectanglesView<Scalar>);
+template <typename Scalar>
+BasicRectangle<Scalar> merge_all(execution::sequenced_policy, BasicRectanglesView<Scalar>);
+template <typename Scalar>
+BasicRectangle<Scalar> merge_all(execution::parallel_policy, BasicRectanglesView<Scalar>);
+template <typename Scalar>
+BasicMergeResult<Scalar> try_merge_all(BasicRectanglesView<Scalar>);
+template <typename Scalar>
+BasicMergeResult<Scalar> try_merge_all(execution::sequenced_policy, BasicRectanglesView<Scalar>);
+template <typename Scalar>
+BasicMergeResult<Scalar> try_merge_all(execution::parallel_policy, BasicRectanglesView<Scalar>);
+
+namespace detail {
+    constexpr std::size_t max_merge_chunks = 64;
+
+    // try_merge_all(execution::par, rects) with the rectangles after the first split
+    // into the given number of chunks (at most max_merge_chunks and one per rectangle),
+    // whatever the size of the pool; fewer than 2 chunks merge sequentially. Lets the
+    // tests run the chunked path on any machine.
+    template <typename Scalar>
+    BasicMergeResult<Scalar> try_merge_all_chunked(BasicRectanglesView<Scalar> rects,
+                                                   std::size_t chunks);
+} // namespace detail
+
+// try_merge_all of many independent chains at once. Chain i, for i < chains, is
+// rects[offsets[i], offsets[i + 1]), so offsets holds chains + 1 increasing indices,
+// the last one at most rects.size(); other offsets terminate the program. results[i]
+// is what try_merge_all of chain i reports, failed_at counting from the start of the
+// chain. results points to storage for chains results, e.g. from std::allocator, in
+// which they are constructed; it need not hold results yet. Returns the number of
+// chains that cannot be merged. Under execution::par the chains are split on the
+// thread pool into runs of about equal numbers of rectangles.
+template <typename Scalar>
+std::size_t try_merge_chains(BasicRectanglesView<Scalar> rects, const std::size_t *offsets,
+                             std::size_t chains, BasicMergeResult<Scalar> *results);
+template <typename Scalar>
+std::size_t try_merge_chains(execution::sequenced_policy, BasicRectanglesView<Scalar> rects,
+                             const std::size_t *offsets, std::size_t chains,
+                             BasicMergeResult<Scalar> *results);
+template <typename Scalar>
+std::size_t try_merge_chains(execution::parallel_policy, BasicRectanglesView<Scalar> rects,
+                             const std::size_t *offsets, std::size_t chains,
+                             BasicMergeResult<Scalar> *results);
+
+namespace detail {
+    // try_merge_all of rects translated by offsets[0], ..., offsets[count - 1] in turn,
+    // without storing the translated rectangles.
+    template <typename Scalar>
+    BasicMergeResult<Scalar> try_merge_translated(BasicRectanglesView<Scalar> rects,
+                                                  const BasicVector<Scalar> *offsets,
+                                                  std::size_t count);
+
+    // Whether rects translated by offsets[0], ..., offsets[count - 1] in turn equal
+    // other, compared without storing the translated rectangles.
+    template <typename Scalar>
+    bool equal_translated(BasicRectanglesView<Scalar> rects, const BasicVector<Scalar> *offsets,
+                          std::size_t count, BasicRectanglesView<Scalar> other);
+} // namespace detail
+
+// Lazy result of adding vectors to a collection: recs + v1 + v2 records the vectors
+// and translates the rectangles in a single pass once the expression is converted to
+// BasicRectangles. merge_all and try_merge_all merge the translated rectangles without
+// storing them. Results, including termination on overflow, are those of translating
+// by each vector in turn, except that try_merge_all reports a rectangle whose
+// translation overflows as one that cannot be merged, with MergeError::overflow.
+//
+// The expression owns its collection: one passed as an rvalue is moved in, any other
+// is copied, and evaluating the expression translates it in place. Only views, e.g.
+// from translated_view, are not copied; such an expression must not outlive the
+// viewed rectangles, and changes made to them before it is evaluated show in the result.
+template <typename Scalar, typename Source>
+class BasicTranslatedRectangles {
+    template <typename, typename>
+    friend class BasicTranslatedRectangles;
+
+    static constexpr bool owned = std::is_same_v<Source, BasicRectangles<Scalar>>;
+    static constexpr bool viewed = std::is_same_v<Source, BasicRectanglesView<Scalar>>;
+    static constexpr bool nested = !owned && !viewed;
+
+  public:
+    // Number of vectors added so far.
+    static constexpr std::size_t depth = [] {
+        if constexpr (nested)
+            return Source::depth + 1;
+        else
+            return std::size_t(1);
+    }();
+
+  private:
+    // BasicRectangles<Scalar> if the collection was moved in, BasicRectanglesView<Scalar>
+    // if the rectangles are only viewed, or the expression this one extends.
+    Source source_;
+    BasicVector<Scalar> offset_;
+    // Where copies of viewed rectangles are allocated: the resource of the viewed
+    // collection, the default one for other views.
+    std::pmr::memory_resource *resource_ = std::pmr::get_default_resource();
+
+    BasicRectanglesView<Scalar> rectangles() const {
+        if constexpr (nested)
+            return source_.rectangles();
+        else
+            return source_;
+    }
+
+    template <std::size_t... I>
+    std::array<BasicVector<Scalar>, depth> offsets(std::index_sequence<I...>) const {
+        const std::array<BasicVector<Scalar>, depth - 1> inner = source_.offsets();
+        return {inner[I]..., offset_};
+    }
+
+    // The vectors in the order they were added.
+    std::array<BasicVector<Scalar>, depth> offsets() const {
+        if constexpr (nested)
+            return offsets(std::make_index_sequence<depth - 1>());
+        else
+            return {offset_};
+    }
+
+    // The rectangles to translate: the collection itself if this expression owns it
+    // and may give it up, a copy (on the resource of the collection, if any) otherwise.
+    BasicRectangles<Scalar> take_collection() && {
+        if constexpr (nested)
+            return std::move(source_).take_collection();
+        else if constexpr (owned)
+            return std::move(source_);
+        else
+            return copy_collection();
+    }
+
+    BasicRectangles<Scalar> copy_collection() const {
+        if constexpr (nested) {
+            return source_.copy_collection();
+        } else if constexpr (viewed) {
+            // Counted as a copy of the viewed collection.
+            GEOMETRY_STATS_ADD(collection_copies, 1);
+            return BasicRectangles<Scalar>(source_.begin(), source_.end(), resource_);
+        } else {
+            return source_;
+        }
+    }
+
+    BasicRectangles<Scalar> translate(BasicRectangles<Scalar> rects) const {
+        rects.translate(offsets().data(), depth);
+        return rects;
+    }
+
+  public:
+    BasicTranslatedRectangles(Source &&source, const BasicVector<Scalar> &offset)
+        : source_(std::forward<Source>(source)), offset_(offset) {
+    }
+
+    // Views the rectangles of a collection, copied from resource when evaluated.
+    BasicTranslatedRectangles(BasicRectanglesView<Scalar> rects,
+                              std::pmr::memory_resource *resource,
+                              const BasicVector<Scalar> &offset)
+        : source_(rects), offset_(offset), resource_(resource) {
+        static_assert(viewed, "Only views carry the resource of their collection");
+    }
+
+    operator BasicRectangles<Scalar>() const & {
+        return translate(copy_collection());
+    }
+
+    operator BasicRectangles<Scalar>() && {
+        return translate(std::move(*this).take_collection());
+    }
+
+    typename BasicRectangles<Scalar>::size_type size() const {
+        return rectangles().size();
+    }
+
+    BasicMergeResult<Scalar> try_merge_all() const {
+        return detail::try_merge_translated(rectangles(), offsets().data(), depth);
+    }
+
+    // Translates and compares the rectangles in one pass, without evaluating the
+    // expression; overflow still ends the program.
+    bool operator==(const BasicRectangles<Scalar> &rects) const {
+        return detail::equal_translated(rectangles(), offsets().data(), depth,
+                                        BasicRectanglesView<Scalar>(rects));
+    }
+};
+
+// Compares in the same single pass whichever side the expression is on.
+template <typename Scalar, typename Source>
+bool operator==(const BasicRectangles<Scalar> &rects,
+                const BasicTranslatedRectangles<Scalar, Source> &expr) {
+    return expr == rects;
+}
+
+template <typename Scalar>
+BasicTranslatedRectangles<Scalar, BasicRectangles<Scalar>>
+operator+(const BasicRectangles<Scalar> &rects, const BasicVector<Scalar> &v) {
+    return {BasicRectangles<Scalar>(rects), v};
+}
+
+template <typename Scalar>
+BasicTranslatedRectangles<Scalar, BasicRectangles<Scalar>>
+operator+(BasicRectangles<Scalar> &&rects, const BasicVector<Scalar> &v) {
+    return {std::move(rects), v};
+}
+
+template <typename Scalar>
+BasicTranslatedRectangles<Scalar, BasicRectanglesView<Scalar>>
+operator+(BasicRectanglesView<Scalar> rects, const BasicVector<Scalar> &v) {
+    return {std::move(rects), v};
+}
+
+template <typename Scalar, typename Source>
+BasicTranslatedRectangles<Scalar, BasicTranslatedRectangles<Scalar, Source>>
+operator+(BasicTranslatedRectangles<Scalar, Source> expr, const BasicVector<Scalar> &v) {
+    return {std::move(expr), v};
+}
+
+template <typename Scalar>
+BasicTranslatedRectangles<Scalar, BasicRectangles<Scalar>>
+operator+(const BasicVector<Scalar> &v, const BasicRectangles<Scalar> &rects) {
+    return rects + v;
+}
+
+template <typename Scalar>
+BasicTranslatedRectangles<Scalar, BasicRectangles<Scalar>>
+operator+(const BasicVector<Scalar> &v, BasicRectangles<Scalar> &&rects) {
+    return std::move(rects) + v;
+}
+
+template <typename Scalar>
+BasicTranslatedRectangles<Scalar, BasicRectanglesView<Scalar>>
+operator+(const BasicVector<Scalar> &v, BasicRectanglesView<Scalar> rects) {
+    return std::move(rects) + v;
+}
+
+template <typename Scalar, typename Source>
+BasicTranslatedRectangles<Scalar, BasicTranslatedRectangles<Scalar, Source>>
+operator+(const BasicVector<Scalar> &v, BasicTranslatedRectangles<Scalar, Source> expr) {
+    return std::move(expr) + v;
+}
+
+// rects + v without copying rects, which therefore must outlive the expression and not
+// change before it is evaluated. Evaluating it copies the rectangles to the resource
+// of rects.
+template <typename Scalar>
+BasicTranslatedRectangles<Scalar, BasicRectanglesView<Scalar>>
+translated_view(const BasicRectangles<Scalar> &rects, const BasicVector<Scalar> &v) {
+    return {BasicRectanglesView<Scalar>(rects), rects.resource(), v};
+}
+
+template <typename Scalar>
+void translated_view(const BasicRectangles<Scalar> &&, const BasicVector<Scalar> &) = delete;
+
+template <typename Scalar>
+BasicTranslatedRectangles<Scalar, BasicRectanglesView<Scalar>>
+translated_view(BasicRectanglesView<Scalar> rects, const BasicVector<Scalar> &v) {
+    return rects + v;
+}
+
+// rects + v evaluated at once under a policy. A collection passed as an rvalue is
+// translated in place and moved out, as with operator+.
+template <typename Scalar>
+BasicRectangles<Scalar> translated(execution::sequenced_policy, BasicRectangles<Scalar> rects,
+                                   const BasicVector<Scalar> &v) {
+    rects.translate(execution::seq, v);
+    return rects;
+}
+
+template <typename Scalar>
+BasicRectangles<Scalar> translated(execution::parallel_policy, BasicRectangles<Scalar> rects,
+                                   const BasicVector<Scalar> &v) {
+    rects.translate(execution::par, v);
+    return rects;
+}
+
+template <typename Scalar, typename Source>
+BasicMergeResult<Scalar> try_merge_all(const BasicTranslatedRectangles<Scalar, Source> &expr) {
+    return expr.try_merge_all();
+}
+
+template <typename Scalar, typename Source>
+BasicRectangle<Scalar> merge_all(const BasicTranslatedRectangles<Scalar, Source> &expr) {
+    return detail::merged_or_fail(expr.try_merge_all());
+}
+
+#define GEOMETRY_EXTERN_TEMPLATES(Scalar)                                                          \
+    extern template class BasicVector<Scalar>;                                                 \
+    extern template class BasicPosition<Scalar>;                                               \
+    extern template class BasicRectangle<Scalar>;                                              \
+    extern template class BasicRectangles<Scalar>;                                             \
+    extern template class BasicColumnarRectangles<Scalar>;                                     \
+    extern template class BasicStreamingMerger<Scalar>;                                        \
+    extern template class BasicIncrementalMerger<Scalar>;
+
+GEOMETRY_EXTERN_TEMPLATES(std::int16_t)
+GEOMETRY_EXTERN_TEMPLATES(std::int32_t)
+GEOMETRY_EXTERN_TEMPLATES(std::int64_t)
+
+#undef GEOMETRY_EXTERN_TEMPLATES
+
+// Hashes for unordered containers, consistent with operator==.
+template <typename Scalar>
+struct std::hash<BasicVector<Scalar>> {
+    std::size_t operator()(const BasicVector<Scalar> &v) const noexcept {
+        return static_cast<std::size_t>(detail::hash_pair(v.x(), v.y()));
+    }
+};
+
+template <typename Scalar>
+struct std::hash<BasicPosition<Scalar>> {
+    std::size_t operator()(const BasicPosition<Scalar> &p) const noexcept {
+        return static_cast<std::size_t>(detail::hash_pair(p.x(), p.y(), 1));
+    }
+};
+
+template <typename Scalar>
+struct std::hash<BasicRectangle<Scalar>> {
+    std::size_t operator()(const BasicRectangle<Scalar> &r) const noexcept {
+        return static_cast<std::size_t>(
+            detail::hash_pair(r.pos().x(), r.pos().y(), detail::hash_pair(r.width(), r.height())));
+    }
+};
 
-Rectangle operator+(const Rectangle &, const Vector &);
-Rectangle operator+(const Vector &, const Rectangle &);
+#define GEOMETRY_LAYOUT_CHECKS(Scalar)                                                             \
+    static_assert(std::is_trivially_copyable_v<BasicVector<Scalar>> &&                         \
+                  std::is_standard_layout_v<BasicVector<Scalar>>);                             \
+    static_assert(std::is_trivially_copyable_v<BasicPosition<Scalar>> &&                       \
+                  std::is_standard_layout_v<BasicPosition<Scalar>>);                           \
+    static_assert(std::is_trivially_copyable_v<BasicRectangle<Scalar>> &&                      \
+                  std::is_standard_layout_v<BasicRectangle<Scalar>>);                          \
+    static_assert(sizeof(BasicVector<Scalar>) == 2 * sizeof(Scalar));                          \
+    static_assert(sizeof(BasicPosition<Scalar>) == 2 * sizeof(Scalar));                        \
+    static_assert(sizeof(BasicRectangle<Scalar>) == 4 * sizeof(Scalar));
 
-Rectangles operator+(Rectangles, const Vector &);
-Rectangles operator+(const Vector &, Rectangles);
+GEOMETRY_LAYOUT_CHECKS(std::int16_t)
+GEOMETRY_LAYOUT_CHECKS(std::int32_t)
+GEOMETRY_LAYOUT_CHECKS(std::int64_t)
 
-Rectangle merge_horizontally(const Rectangle &, const Rectangle &);
-Rectangle merge_vertically(const Rectangle &, const Rectangle &);
-Rectangle merge_all(const Rectangles &);
+#undef GEOMETRY_LAYOUT_CHECKS
 
 #endif // GEOMETRY_GEOMETRY_H
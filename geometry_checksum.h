@@ -0,0 +1,74 @@
+#ifndef GEOMETRY_GEOMETRY_CHECKSUM_H
+#define GEOMETRY_GEOMETRY_CHECKSUM_H
+
+#include "geometry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Internal checksum shared by the file format (geometry_io.cc) and the content
+// fingerprints of collections (geometry.cc). Changing it changes the file format.
+namespace detail {
+    // 64-bit checksum in the style of xxHash64: four independent lanes over 32-byte
+    // stripes keep the loop from waiting on the latency of the multiplications. The
+    // bytes may be fed in pieces; all but the last must be whole stripes.
+    class Checksum {
+        static constexpr std::uint64_t prime1 = 0x9e3779b185ebca87ULL;
+        static constexpr std::uint64_t prime2 = 0xc2b2ae3d27d4eb4fULL;
+
+        std::uint64_t lanes_[4] = {prime1 + prime2, prime2, 0, 0 - prime1};
+        std::uint64_t h_ = 0;
+        std::uint64_t length_ = 0;
+        bool tail_ = false;
+
+        static std::uint64_t rotl(std::uint64_t x, int r) {
+            return (x << r) | (x >> (64 - r));
+        }
+
+        static std::uint64_t round(std::uint64_t acc, std::uint64_t word) {
+            return rotl(acc + word * prime2, 31) * prime1;
+        }
+
+        std::uint64_t digest_lanes() const {
+            return rotl(lanes_[0], 1) + rotl(lanes_[1], 7) + rotl(lanes_[2], 12) +
+                   rotl(lanes_[3], 18) + length_;
+        }
+
+      public:
+        void update(const unsigned char *bytes, std::size_t n) {
+            GEOMETRY_ASSERT(!tail_, "Only the last piece may end with a partial stripe.");
+            std::size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                for (int k = 0; k < 4; ++k) {
+                    std::uint64_t word;
+                    std::memcpy(&word, bytes + i + 8 * k, 8);
+                    lanes_[k] = round(lanes_[k], word);
+                }
+            }
+            length_ += n;
+            if (i == n)
+                return;
+            tail_ = true;
+            h_ = digest_lanes();
+            for (; i < n; ++i)
+                h_ = rotl(h_ ^ (bytes[i] * prime1), 11) * prime2;
+        }
+
+        std::uint64_t digest() const {
+            std::uint64_t h = tail_ ? h_ : digest_lanes();
+            h ^= h >> 33;
+            h *= prime2;
+            h ^= h >> 29;
+            return h;
+        }
+    };
+
+    inline std::uint64_t checksum(const unsigned char *bytes, std::size_t n) {
+        Checksum sum;
+        sum.update(bytes, n);
+        return sum.digest();
+    }
+} // namespace detail
+
+#endif // GEOMETRY_GEOMETRY_CHECKSUM_H
@@ -0,0 +1,251 @@
+#include "geometry_index.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace {
+    // Position of (x, y) on the Hilbert curve filling a 2^16 x 2^16 grid.
+    std::uint32_t hilbert_key(std::uint32_t x, std::uint32_t y) {
+        constexpr std::uint32_t n = std::uint32_t(1) << 16;
+        std::uint32_t d = 0;
+        for (std::uint32_t s = n / 2; s > 0; s /= 2) {
+            const std::uint32_t rx = (x & s) > 0;
+            const std::uint32_t ry = (y & s) > 0;
+            d += s * s * ((3 * rx) ^ ry);
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = n - 1 - x;
+                    y = n - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+    // Stable LSD radix sort of order by keys, two passes of 16 bits each. Linear in the
+    // number of elements, which matters when bulk loading tens of millions of them.
+    void radix_sort(std::vector<std::uint32_t> &keys, std::vector<std::size_t> &order) {
+        const std::size_t n = keys.size();
+        std::vector<std::uint32_t> keys_tmp(n);
+        std::vector<std::size_t> order_tmp(n);
+        std::vector<std::size_t> count(std::size_t(1) << 16);
+        for (unsigned shift = 0; shift < 32; shift += 16) {
+            std::fill(count.begin(), count.end(), 0);
+            for (std::size_t i = 0; i < n; ++i)
+                ++count[(keys[i] >> shift) & 0xffff];
+            std::size_t sum = 0;
+            for (std::size_t &c : count)
+                sum += std::exchange(c, sum);
+            for (std::size_t i = 0; i < n; ++i) {
+                const std::size_t to = count[(keys[i] >> shift) & 0xffff]++;
+                keys_tmp[to] = keys[i];
+                order_tmp[to] = order[i];
+            }
+            keys.swap(keys_tmp);
+            order.swap(order_tmp);
+        }
+    }
+} // namespace
+
+template <typename Scalar>
+BasicRectangleIndex<Scalar>::BasicRectangleIndex(const BasicRectangles<Scalar> &rects)
+    : size_(rects.size()) {
+    const size_type n = size_;
+    if (n == 0)
+        return;
+
+    std::vector<Box> leaves;
+    leaves.reserve(n);
+    Box bounds{std::numeric_limits<Scalar>::max(), std::numeric_limits<Scalar>::max(),
+               std::numeric_limits<Scalar>::min(), std::numeric_limits<Scalar>::min()};
+    for (size_type i = 0; i < n; ++i) {
+        const BasicRectangle<Scalar> &r = rects[i];
+        const Box b{r.pos().x(), r.pos().y(), detail::checked_add(r.pos().x(), r.width()),
+                    detail::checked_add(r.pos().y(), r.height())};
+        bounds = {std::min(bounds.min_x, b.min_x), std::min(bounds.min_y, b.min_y),
+                  std::max(bounds.max_x, b.max_x), std::max(bounds.max_y, b.max_y)};
+        leaves.push_back(b);
+    }
+
+    // Order the leaves along the Hilbert curve through their centres.
+    const double scale_x = 65535.0 / std::max(1.0, double(bounds.max_x) - bounds.min_x);
+    const double scale_y = 65535.0 / std::max(1.0, double(bounds.max_y) - bounds.min_y);
+    std::vector<std::uint32_t> keys(n);
+    std::vector<size_type> order(n);
+    for (size_type i = 0; i < n; ++i) {
+        const Box &b = leaves[i];
+        const double cx = (double(b.min_x) + b.max_x) / 2 - bounds.min_x;
+        const double cy = (double(b.min_y) + b.max_y) / 2 - bounds.min_y;
+        keys[i] = hilbert_key(static_cast<std::uint32_t>(cx * scale_x),
+                              static_cast<std::uint32_t>(cy * scale_y));
+        order[i] = i;
+    }
+    radix_sort(keys, order);
+
+    size_type nodes = n;
+    for (size_type level = n; level > 1; level = (level + node_size - 1) / node_size)
+        nodes += (level + node_size - 1) / node_size;
+    boxes_.reserve(nodes);
+    indices_.reserve(nodes);
+    for (size_type i = 0; i < n; ++i) {
+        boxes_.push_back(leaves[order[i]]);
+        indices_.push_back(order[i]);
+    }
+    level_ends_.push_back(n);
+
+    // Pack every level into parents of node_size consecutive nodes until one is left.
+    for (size_type begin = 0, end = n; end - begin > 1; begin = end, end = boxes_.size()) {
+        for (size_type first = begin; first < end; first += node_size) {
+            const size_type last = std::min(first + node_size, end);
+            Box b = boxes_[first];
+            for (size_type c = first + 1; c < last; ++c) {
+                b = {std::min(b.min_x, boxes_[c].min_x), std::min(b.min_y, boxes_[c].min_y),
+                     std::max(b.max_x, boxes_[c].max_x), std::max(b.max_y, boxes_[c].max_y)};
+            }
+            boxes_.push_back(b);
+            indices_.push_back(first);
+        }
+        level_ends_.push_back(boxes_.size());
+    }
+}
+
+template <typename Scalar>
+template <typename Overlaps>
+typename BasicRectangleIndex<Scalar>::size_type
+BasicRectangleIndex<Scalar>::search(Overlaps overlaps, size_type *out,
+                                    size_type capacity) const {
+    if (size_ == 0)
+        return 0;
+
+    size_type found = 0;
+    auto report = [&](size_type leaf) {
+        if (found < capacity)
+            out[found] = indices_[leaf];
+        ++found;
+    };
+
+    const size_type root = boxes_.size() - 1;
+    if (level_ends_.size() == 1) {
+        if (overlaps(boxes_[root]))
+            report(root);
+        return found;
+    }
+
+    // Depth-first traversal with a fixed-size stack: it never holds more than the
+    // children of one node per level, and there are far fewer than 32 levels.
+    std::pair<size_type, size_type> stack[node_size * 32];
+    size_type depth = 0;
+    stack[depth++] = {root, level_ends_.size() - 1};
+    while (depth > 0) {
+        const auto [node, level] = stack[--depth];
+        const size_type first = indices_[node];
+        const size_type last = std::min(first + node_size, level_ends_[level - 1]);
+        for (size_type c = first; c < last; ++c) {
+            if (!overlaps(boxes_[c]))
+                continue;
+            if (level == 1)
+                report(c);
+            else
+                stack[depth++] = {c, level - 1};
+        }
+    }
+    return found;
+}
+
+template <typename Scalar>
+typename BasicRectangleIndex<Scalar>::size_type
+BasicRectangleIndex<Scalar>::query_point(const BasicPosition<Scalar> &p, size_type *out,
+                                         size_type capacity) const {
+    const Scalar x = p.x(), y = p.y();
+    return search(
+        [x, y](const Box &b) {
+            return b.min_x <= x && x < b.max_x && b.min_y <= y && y < b.max_y;
+        },
+        out, capacity);
+}
+
+template <typename Scalar>
+typename BasicRectangleIndex<Scalar>::size_type
+BasicRectangleIndex<Scalar>::query_window(const BasicRectangle<Scalar> &window, size_type *out,
+                                          size_type capacity) const {
+    const Box w{window.pos().x(), window.pos().y(),
+                detail::checked_add(window.pos().x(), window.width()),
+                detail::checked_add(window.pos().y(), window.height())};
+    return search(
+        [w](const Box &b) {
+            return b.min_x < w.max_x && w.min_x < b.max_x && b.min_y < w.max_y &&
+                   w.min_y < b.max_y;
+        },
+        out, capacity);
+}
+
+namespace {
+    template <typename Box>
+    double squared_distance(const Box &b, double x, double y) {
+        const double dx = std::max({double(b.min_x) - x, 0.0, x - double(b.max_x)});
+        const double dy = std::max({double(b.min_y) - y, 0.0, y - double(b.max_y)});
+        return dx * dx + dy * dy;
+    }
+} // namespace
+
+template <typename Scalar>
+typename BasicRectangleIndex<Scalar>::size_type
+BasicRectangleIndex<Scalar>::nearest(const BasicPosition<Scalar> &p, size_type *out,
+                                     size_type k) const {
+    k = std::min(k, size_);
+    if (k == 0)
+        return 0;
+
+    // out holds the best leaves found so far, nearest first, as positions in boxes_;
+    // they are translated to collection indices once the search is done.
+    size_type found = 0;
+    const size_type root = boxes_.size() - 1;
+    if (level_ends_.size() == 1) {
+        out[found++] = root;
+    } else {
+        nearest_in(root, level_ends_.size() - 1, double(p.x()), double(p.y()), out, k, found);
+    }
+    for (size_type i = 0; i < found; ++i)
+        out[i] = indices_[out[i]];
+    return found;
+}
+
+template <typename Scalar>
+void BasicRectangleIndex<Scalar>::nearest_in(size_type node, size_type level, double px,
+                                             double py, size_type *out, size_type k,
+                                             size_type &found) const {
+    const size_type first = indices_[node];
+    const size_type last = std::min(first + node_size, level_ends_[level - 1]);
+    auto worst = [&] {
+        return found < k ? std::numeric_limits<double>::infinity()
+                         : squared_distance(boxes_[out[k - 1]], px, py);
+    };
+
+    if (level == 1) {
+        for (size_type c = first; c < last; ++c) {
+            const double d = squared_distance(boxes_[c], px, py);
+            if (!(d < worst()))
+                continue;
+            size_type at = found < k ? found++ : k - 1;
+            for (; at > 0 && d < squared_distance(boxes_[out[at - 1]], px, py); --at)
+                out[at] = out[at - 1];
+            out[at] = c;
+        }
+        return;
+    }
+
+    // Visit the children nearest first, so the bound tightens as early as possible.
+    std::pair<double, size_type> children[node_size];
+    size_type count = 0;
+    for (size_type c = first; c < last; ++c)
+        children[count++] = {squared_distance(boxes_[c], px, py), c};
+    std::sort(children, children + count);
+    for (size_type i = 0; i < count && children[i].first < worst(); ++i)
+        nearest_in(children[i].second, level - 1, px, py, out, k, found);
+}
+
+template class BasicRectangleIndex<std::int16_t>;
+template class BasicRectangleIndex<std::int32_t>;
+template class BasicRectangleIndex<std::int64_t>;
@@ -0,0 +1,77 @@
+#ifndef GEOMETRY_GEOMETRY_INDEX_H
+#define GEOMETRY_GEOMETRY_INDEX_H
+
+#include "geometry.h"
+
+#include <cstddef>
+#include <vector>
+
+// Static spatial index over a Rectangles collection: a packed R-tree whose leaves
+// are ordered along a Hilbert curve. The index is built once, in O(n) apart from
+// computing the curve keys, and is immutable afterwards.
+//
+// A rectangle covers the half-open area [x, x + width) x [y, y + height), so
+// rectangles that only share an edge neither overlap nor contain each other's
+// corners. Queries report positions in the indexed collection and write them into
+// caller-provided buffers; they never allocate.
+template <typename Scalar>
+class BasicRectangleIndex {
+  public:
+    using size_type = std::size_t;
+
+    static constexpr size_type node_size = 16;
+
+    BasicRectangleIndex() = default;
+    BasicRectangleIndex(const BasicRectangleIndex &) = default;
+    BasicRectangleIndex &operator=(const BasicRectangleIndex &) = default;
+    BasicRectangleIndex(BasicRectangleIndex &&) noexcept = default;
+    BasicRectangleIndex &operator=(BasicRectangleIndex &&) noexcept = default;
+    ~BasicRectangleIndex() = default;
+
+    explicit BasicRectangleIndex(const BasicRectangles<Scalar> &rects);
+
+    size_type size() const {
+        return size_;
+    }
+
+    // Rectangles containing p. Writes at most capacity indices to out and returns
+    // the total number of matches, which may be larger.
+    size_type query_point(const BasicPosition<Scalar> &p, size_type *out,
+                          size_type capacity) const;
+
+    // Rectangles overlapping window, with the same output convention as query_point.
+    size_type query_window(const BasicRectangle<Scalar> &window, size_type *out,
+                           size_type capacity) const;
+
+    // The k rectangles closest to p (by Euclidean distance, 0 inside), nearest first.
+    // Writes them to out and returns how many were written, i.e. min(k, size()).
+    size_type nearest(const BasicPosition<Scalar> &p, size_type *out, size_type k) const;
+
+  private:
+    struct Box {
+        Scalar min_x, min_y, max_x, max_y;
+    };
+
+    // Nodes of all levels, leaves (the rectangles themselves) first and the root last.
+    std::vector<Box> boxes_;
+    // For leaves the position in the indexed collection, for inner nodes the position
+    // of the first child in boxes_.
+    std::vector<size_type> indices_;
+    // One past the last node of every level, from the leaves up.
+    std::vector<size_type> level_ends_;
+    size_type size_ = 0;
+
+    template <typename Overlaps>
+    size_type search(Overlaps overlaps, size_type *out, size_type capacity) const;
+
+    void nearest_in(size_type node, size_type level, double px, double py, size_type *out,
+                    size_type k, size_type &found) const;
+};
+
+using RectangleIndex = BasicRectangleIndex<std::int32_t>;
+
+extern template class BasicRectangleIndex<std::int16_t>;
+extern template class BasicRectangleIndex<std::int32_t>;
+extern template class BasicRectangleIndex<std::int64_t>;
+
+#endif // GEOMETRY_GEOMETRY_INDEX_H
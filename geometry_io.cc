@@ -0,0 +1,272 @@
+#include "geometry_io.h"
+#include "geometry_checksum.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr char magic[8] = {'G', 'E', 'O', 'M', 'R', 'E', 'C', 'T'};
+    constexpr std::uint16_t version = 1;
+
+    struct Header {
+        char magic[8];
+        std::uint16_t version;
+        std::uint16_t scalar_size;
+        std::uint32_t reserved;
+        std::uint64_t count;
+        std::uint64_t checksum;
+    };
+
+    static_assert(sizeof(Header) == 32 && std::is_trivially_copyable_v<Header>);
+
+    [[noreturn]] void throw_system_error(const std::string &what, const std::string &path) {
+        throw std::system_error(errno, std::generic_category(), "geometry: " + what + " " + path);
+    }
+
+    // Closes the descriptor when leaving the scope.
+    class FileDescriptor {
+        int fd_;
+
+      public:
+        explicit FileDescriptor(int fd) : fd_(fd) {
+        }
+        FileDescriptor(const FileDescriptor &) = delete;
+        FileDescriptor &operator=(const FileDescriptor &) = delete;
+        ~FileDescriptor() {
+            if (fd_ >= 0)
+                ::close(fd_);
+        }
+
+        int get() const {
+            return fd_;
+        }
+    };
+
+    // Reads exactly n bytes unless the file ends first; returns the number read.
+    std::size_t read_all(int fd, void *data, std::size_t n, const std::string &path) {
+        char *p = static_cast<char *>(data);
+        std::size_t total = 0;
+        while (total < n) {
+            const ssize_t got = ::read(fd, p + total, n - total);
+            if (got < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw_system_error("cannot read", path);
+            }
+            if (got == 0)
+                break;
+            total += static_cast<std::size_t>(got);
+        }
+        return total;
+    }
+
+    // Checks everything in the header but the checksum, which needs the payload.
+    template <typename Scalar>
+    void check_header(const Header &header, std::size_t payload, const std::string &path) {
+        if (std::memcmp(header.magic, magic, sizeof magic) != 0)
+            throw FormatError("geometry: " + path + " is not a rectangles file");
+        if (header.version != version)
+            throw FormatError("geometry: " + path + " has unsupported format version " +
+                              std::to_string(header.version));
+        if (header.scalar_size != sizeof(Scalar))
+            throw FormatError("geometry: " + path + " has " +
+                              std::to_string(header.scalar_size) + "-byte coordinates, not " +
+                              std::to_string(sizeof(Scalar)));
+        constexpr std::size_t stride = sizeof(BasicRectangle<Scalar>);
+        if (header.count != payload / stride || payload % stride != 0)
+            throw FormatError("geometry: " + path + " is truncated or has trailing data");
+    }
+
+    // Throws unless every one of the n records at bytes has a positive width and height,
+    // as BasicRectangle requires; first is the index of the first record in the file.
+    template <typename Scalar>
+    void check_records(const unsigned char *bytes, std::size_t n, std::uint64_t first,
+                       const std::string &path) {
+        const auto *rects = reinterpret_cast<const BasicRectangle<Scalar> *>(bytes);
+        auto invalid = [](const BasicRectangle<Scalar> &r) {
+            return (r.width() <= 0) | (r.height() <= 0);
+        };
+        // Without early exit, so that the common case of a valid file vectorizes.
+        bool any = false;
+        for (std::size_t i = 0; i < n; ++i)
+            any |= invalid(rects[i]);
+        if (!any)
+            return;
+        const std::size_t at =
+            static_cast<std::size_t>(std::find_if(rects, rects + n, invalid) - rects);
+        throw FormatError("geometry: " + path + " has a rectangle without a positive width " +
+                          "and height at index " + std::to_string(first + at));
+    }
+
+    // Size of the pieces the records are checked in, together with the checksum if
+    // there is one to verify, while they are in the cache: whole checksum stripes.
+    constexpr std::size_t piece_size = 65536;
+
+    void write_all(int fd, const void *data, std::size_t n, const std::string &path) {
+        const char *p = static_cast<const char *>(data);
+        while (n > 0) {
+            const ssize_t written = ::write(fd, p, n);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw_system_error("cannot write", path);
+            }
+            p += written;
+            n -= static_cast<std::size_t>(written);
+        }
+    }
+} // namespace
+
+template <typename Scalar>
+void save(const std::string &path, BasicRectanglesView<Scalar> rects) {
+    const std::size_t bytes = rects.size() * sizeof(BasicRectangle<Scalar>);
+    const auto *payload = reinterpret_cast<const unsigned char *>(rects.data());
+
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof magic);
+    header.version = version;
+    header.scalar_size = sizeof(Scalar);
+    header.count = rects.size();
+    header.checksum = detail::checksum(payload, bytes);
+
+    const FileDescriptor fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+    if (fd.get() < 0)
+        throw_system_error("cannot create", path);
+    write_all(fd.get(), &header, sizeof header, path);
+    write_all(fd.get(), payload, bytes, path);
+    if (::fsync(fd.get()) != 0)
+        throw_system_error("cannot write", path);
+}
+
+template <typename Scalar>
+BasicMappedRectangles<Scalar>::BasicMappedRectangles(const std::string &path,
+                                                     bool verify_checksum) {
+    const FileDescriptor fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd.get() < 0)
+        throw_system_error("cannot open", path);
+    struct stat st;
+    if (::fstat(fd.get(), &st) != 0)
+        throw_system_error("cannot open", path);
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    if (size < sizeof(Header))
+        throw FormatError("geometry: " + path + " is too short for a rectangles file");
+
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+    if (mapping == MAP_FAILED)
+        throw_system_error("cannot map", path);
+    // The destructor does not run when the constructor throws, so failed checks unmap
+    // the file themselves.
+    try {
+        Header header;
+        std::memcpy(&header, mapping, sizeof header);
+        const std::size_t payload = size - sizeof(Header);
+        check_header<Scalar>(header, payload, path);
+
+        const auto *bytes = static_cast<const unsigned char *>(mapping) + sizeof(Header);
+        ::madvise(mapping, size, MADV_SEQUENTIAL);
+        constexpr std::size_t per_piece = piece_size / sizeof(value_type);
+        detail::Checksum sum;
+        for (std::size_t first = 0; first < header.count; first += per_piece) {
+            const std::size_t n = std::min<std::size_t>(per_piece, header.count - first);
+            const unsigned char *piece = bytes + first * sizeof(value_type);
+            if (verify_checksum)
+                sum.update(piece, n * sizeof(value_type));
+            check_records<Scalar>(piece, n, first, path);
+        }
+        if (verify_checksum && sum.digest() != header.checksum)
+            throw FormatError("geometry: " + path + " is corrupted (checksum mismatch)");
+        rects_ = BasicRectanglesView<Scalar>(reinterpret_cast<const value_type *>(bytes),
+                                             header.count);
+    } catch (...) {
+        ::munmap(mapping, size);
+        throw;
+    }
+    mapping_ = mapping;
+    mapping_size_ = size;
+}
+
+template <typename Scalar>
+BasicMappedRectangles<Scalar>::BasicMappedRectangles(BasicMappedRectangles &&other) noexcept
+    : mapping_(std::exchange(other.mapping_, nullptr)),
+      mapping_size_(std::exchange(other.mapping_size_, 0)),
+      rects_(std::exchange(other.rects_, BasicRectanglesView<Scalar>())) {
+}
+
+template <typename Scalar>
+BasicMappedRectangles<Scalar> &
+BasicMappedRectangles<Scalar>::operator=(BasicMappedRectangles &&other) noexcept {
+    if (this != &other) {
+        if (mapping_)
+            ::munmap(mapping_, mapping_size_);
+        mapping_ = std::exchange(other.mapping_, nullptr);
+        mapping_size_ = std::exchange(other.mapping_size_, 0);
+        rects_ = std::exchange(other.rects_, BasicRectanglesView<Scalar>());
+    }
+    return *this;
+}
+
+template <typename Scalar>
+BasicMappedRectangles<Scalar>::~BasicMappedRectangles() {
+    if (mapping_)
+        ::munmap(mapping_, mapping_size_);
+}
+
+template <typename Scalar>
+BasicMergeResult<Scalar> try_merge_file(const std::string &path) {
+    const FileDescriptor fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd.get() < 0)
+        throw_system_error("cannot open", path);
+    struct stat st;
+    if (::fstat(fd.get(), &st) != 0)
+        throw_system_error("cannot open", path);
+    ::posix_fadvise(fd.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    Header header;
+    if (read_all(fd.get(), &header, sizeof header, path) != sizeof header)
+        throw FormatError("geometry: " + path + " is too short for a rectangles file");
+    check_header<Scalar>(header, static_cast<std::size_t>(st.st_size) - sizeof header, path);
+    if (header.count == 0)
+        throw FormatError("geometry: " + path + " is empty, there is nothing to merge");
+
+    // A fixed buffer of whole checksum stripes: 64 KiB whatever the coordinate width.
+    constexpr std::size_t batch = piece_size / sizeof(BasicRectangle<Scalar>);
+    static_assert(batch * sizeof(BasicRectangle<Scalar>) == piece_size);
+    const std::unique_ptr<unsigned char[]> buffer(new unsigned char[piece_size]);
+    BasicStreamingMerger<Scalar> merger;
+    detail::Checksum sum;
+    for (std::uint64_t left = header.count; left > 0;) {
+        const std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(left, batch));
+        const std::size_t bytes = n * sizeof(BasicRectangle<Scalar>);
+        if (read_all(fd.get(), buffer.get(), bytes, path) != bytes)
+            throw FormatError("geometry: " + path + " is truncated or has trailing data");
+        sum.update(buffer.get(), bytes);
+        check_records<Scalar>(buffer.get(), n, header.count - left, path);
+        merger.push(BasicRectanglesView<Scalar>(
+            reinterpret_cast<const BasicRectangle<Scalar> *>(buffer.get()), n));
+        left -= n;
+    }
+    if (sum.digest() != header.checksum)
+        throw FormatError("geometry: " + path + " is corrupted (checksum mismatch)");
+    return merger.result();
+}
+
+template void save(const std::string &, BasicRectanglesView<std::int16_t>);
+template void save(const std::string &, BasicRectanglesView<std::int32_t>);
+template void save(const std::string &, BasicRectanglesView<std::int64_t>);
+
+template BasicMergeResult<std::int16_t> try_merge_file(const std::string &);
+template BasicMergeResult<std::int32_t> try_merge_file(const std::string &);
+template BasicMergeResult<std::int64_t> try_merge_file(const std::string &);
+
+template class BasicMappedRectangles<std::int16_t>;
+template class BasicMappedRectangles<std::int32_t>;
+template class BasicMappedRectangles<std::int64_t>;
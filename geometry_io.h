@@ -0,0 +1,165 @@
+#ifndef GEOMETRY_GEOMETRY_IO_H
+#define GEOMETRY_GEOMETRY_IO_H
+
+#include "geometry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+
+// Binary files of rectangles. A file is a 32-byte header followed by the rectangles,
+// all little-endian:
+//
+//     offset  size  field
+//          0     8  magic "GEOMRECT"
+//          8     2  format version, currently 1
+//         10     2  bytes per coordinate (2, 4 or 8)
+//         12     4  reserved, 0
+//         16     8  number of rectangles
+//         24     8  checksum of the rectangles
+//         32        width, height, x, y of every rectangle, one coordinate each
+//
+// The records have the layout of BasicRectangle in memory, so a mapped file can be
+// used in place. Failing system calls throw std::system_error, files that are not in
+// this format (or whose coordinates are of another width) throw FormatError. So do
+// records that are not rectangles, with a width or height that is not positive; they
+// are checked whenever a file is read, also without verifying the checksum.
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "geometry_io.h maps files in place and needs a little-endian target."
+#endif
+
+class FormatError : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+// Writes the rectangles to path, replacing the file if it exists.
+template <typename Scalar>
+void save(const std::string &path, BasicRectanglesView<Scalar> rects);
+template <typename Scalar>
+void save(const std::string &path, const BasicRectangles<Scalar> &rects) {
+    save(path, BasicRectanglesView<Scalar>(rects));
+}
+
+// Read-only view of a file mapped into memory. The rectangles are neither copied nor
+// converted; the pages are read in by the system as they are accessed. Unless
+// verify_checksum is false, the whole file is read once to check the checksum. The
+// dimensions of the rectangles are checked in any case, in the same pass.
+template <typename Scalar>
+class BasicMappedRectangles {
+  public:
+    using value_type = BasicRectangle<Scalar>;
+    using size_type = std::size_t;
+    using const_iterator = const value_type *;
+
+  private:
+    void *mapping_ = nullptr;
+    std::size_t mapping_size_ = 0;
+    BasicRectanglesView<Scalar> rects_;
+
+  public:
+    explicit BasicMappedRectangles(const std::string &path, bool verify_checksum = true);
+    BasicMappedRectangles(const BasicMappedRectangles &) = delete;
+    BasicMappedRectangles &operator=(const BasicMappedRectangles &) = delete;
+    BasicMappedRectangles(BasicMappedRectangles &&other) noexcept;
+    BasicMappedRectangles &operator=(BasicMappedRectangles &&other) noexcept;
+    ~BasicMappedRectangles();
+
+    BasicRectanglesView<Scalar> view() const noexcept {
+        return rects_;
+    }
+
+    operator BasicRectanglesView<Scalar>() const noexcept {
+        return rects_;
+    }
+
+    const value_type &operator[](size_type n) const {
+        return rects_[n];
+    }
+
+    const value_type *data() const noexcept {
+        return rects_.data();
+    }
+    const_iterator begin() const noexcept {
+        return rects_.begin();
+    }
+    const_iterator end() const noexcept {
+        return rects_.end();
+    }
+    size_type size() const noexcept {
+        return rects_.size();
+    }
+};
+
+using MappedRectangles = BasicMappedRectangles<std::int32_t>;
+
+// Reads a whole file into a new collection.
+template <typename Scalar = std::int32_t>
+BasicRectangles<Scalar> load(const std::string &path, std::pmr::memory_resource *resource =
+                                                          std::pmr::get_default_resource()) {
+    const BasicMappedRectangles<Scalar> mapped(path);
+    return BasicRectangles<Scalar>(mapped.begin(), mapped.end(), resource);
+}
+
+// try_merge_all of the rectangles in a file, read piece by piece through a buffer of
+// fixed size, so that files larger than memory can be merged. The whole file is read,
+// also after a rectangle that cannot be merged, to verify the checksum.
+template <typename Scalar = std::int32_t>
+BasicMergeResult<Scalar> try_merge_file(const std::string &path);
+
+// Mapped files take part in the operations on views directly.
+template <typename Scalar>
+BasicRectangle<Scalar> merge_all(const BasicMappedRectangles<Scalar> &mapped) {
+    return merge_all(mapped.view());
+}
+
+template <typename Scalar>
+BasicMergeResult<Scalar> try_merge_all(const BasicMappedRectangles<Scalar> &mapped) {
+    return try_merge_all(mapped.view());
+}
+
+template <typename Scalar>
+BasicTranslatedRectangles<Scalar, BasicRectanglesView<Scalar>>
+operator+(const BasicMappedRectangles<Scalar> &mapped, const BasicVector<Scalar> &v) {
+    return mapped.view() + v;
+}
+
+template <typename Scalar>
+BasicTranslatedRectangles<Scalar, BasicRectanglesView<Scalar>>
+operator+(const BasicVector<Scalar> &v, const BasicMappedRectangles<Scalar> &mapped) {
+    return v + mapped.view();
+}
+
+template <typename Scalar>
+bool operator==(const BasicMappedRectangles<Scalar> &mapped, BasicRectanglesView<Scalar> rects) {
+    return mapped.view() == rects;
+}
+
+template <typename Scalar>
+bool operator==(const BasicMappedRectangles<Scalar> &mapped,
+                const BasicRectangles<Scalar> &rects) {
+    return mapped.view() == rects;
+}
+
+template <typename Scalar>
+bool operator==(const BasicRectangles<Scalar> &rects,
+                const BasicMappedRectangles<Scalar> &mapped) {
+    return mapped.view() == rects;
+}
+
+extern template void save(const std::string &, BasicRectanglesView<std::int16_t>);
+extern template void save(const std::string &, BasicRectanglesView<std::int32_t>);
+extern template void save(const std::string &, BasicRectanglesView<std::int64_t>);
+
+extern template BasicMergeResult<std::int16_t> try_merge_file(const std::string &);
+extern template BasicMergeResult<std::int32_t> try_merge_file(const std::string &);
+extern template BasicMergeResult<std::int64_t> try_merge_file(const std::string &);
+
+extern template class BasicMappedRectangles<std::int16_t>;
+extern template class BasicMappedRectangles<std::int32_t>;
+extern template class BasicMappedRectangles<std::int64_t>;
+
+#endif // GEOMETRY_GEOMETRY_IO_H
@@ -0,0 +1,361 @@
+#include "geometry_overlap.h"
+#include "geometry_parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <set>
+
+namespace {
+    template <typename Scalar>
+    struct Box {
+        Scalar x0, y0, x1, y1;
+        std::size_t id;
+    };
+
+    template <typename Scalar>
+    std::vector<Box<Scalar>> boxes_of(const BasicRectangles<Scalar> &rects) {
+        std::vector<Box<Scalar>> boxes;
+        boxes.reserve(rects.size());
+        for (std::size_t i = 0; i < rects.size(); ++i) {
+            const BasicRectangle<Scalar> &r = rects[i];
+            boxes.push_back({r.pos().x(), r.pos().y(), detail::checked_add(r.pos().x(), r.width()),
+                             detail::checked_add(r.pos().y(), r.height()), i});
+        }
+        return boxes;
+    }
+
+    // Exact b - a for a <= b, even where the difference does not fit in Scalar.
+    template <typename Scalar>
+    std::uint64_t distance(Scalar a, Scalar b) {
+        return static_cast<std::uint64_t>(static_cast<std::int64_t>(b)) -
+               static_cast<std::uint64_t>(static_cast<std::int64_t>(a));
+    }
+
+    // Sweep events ordered by x; at equal x rectangles end before others begin, so
+    // rectangles that only touch are never active together.
+    struct Event {
+        std::size_t box;
+        bool begins;
+    };
+
+    template <typename Scalar>
+    std::vector<Event> sorted_events(const std::vector<Box<Scalar>> &boxes) {
+        std::vector<Event> events;
+        events.reserve(2 * boxes.size());
+        for (std::size_t i = 0; i < boxes.size(); ++i) {
+            events.push_back({i, true});
+            events.push_back({i, false});
+        }
+        auto x = [&](const Event &e) { return e.begins ? boxes[e.box].x0 : boxes[e.box].x1; };
+        std::sort(events.begin(), events.end(), [&](const Event &a, const Event &b) {
+            return x(a) != x(b) ? x(a) < x(b) : a.begins < b.begins;
+        });
+        return events;
+    }
+
+    // Segment tree over the elementary intervals between consecutive y coordinates,
+    // keeping the total length covered by at least one active rectangle.
+    template <typename Scalar>
+    class CoverTree {
+        const std::vector<Scalar> &ys_;
+        std::vector<std::uint32_t> count_;
+        std::vector<std::uint64_t> covered_;
+
+        void update(std::size_t node, std::size_t l, std::size_t r, std::size_t ql,
+                    std::size_t qr, int delta) {
+            if (qr <= l || r <= ql)
+                return;
+            if (ql <= l && r <= qr) {
+                count_[node] += delta;
+            } else {
+                const std::size_t mid = l + (r - l) / 2;
+                update(2 * node, l, mid, ql, qr, delta);
+                update(2 * node + 1, mid, r, ql, qr, delta);
+            }
+            if (count_[node] > 0)
+                covered_[node] = distance(ys_[l], ys_[r]);
+            else
+                covered_[node] = r - l == 1 ? 0 : covered_[2 * node] + covered_[2 * node + 1];
+        }
+
+      public:
+        explicit CoverTree(const std::vector<Scalar> &ys)
+            : ys_(ys), count_(4 * ys.size()), covered_(4 * ys.size()) {
+        }
+
+        void add(Scalar y0, Scalar y1, int delta) {
+            const std::size_t l = std::lower_bound(ys_.begin(), ys_.end(), y0) - ys_.begin();
+            const std::size_t r = std::lower_bound(ys_.begin(), ys_.end(), y1) - ys_.begin();
+            update(1, 0, ys_.size() - 1, l, r, delta);
+        }
+
+        std::uint64_t covered() const {
+            return covered_[1];
+        }
+    };
+
+    // Segment tree over the elementary intervals between consecutive y coordinates.
+    // Every node lists the active boxes whose y range is split onto it, so the boxes
+    // containing a point are those listed on the path to its leaf. Boxes that ended
+    // are dropped lazily, when a query comes across them.
+    template <typename Scalar>
+    class StabbingTree {
+        const std::vector<Scalar> &ys_;
+        std::vector<std::vector<std::size_t>> lists_;
+        std::vector<bool> active_;
+
+        void insert(std::size_t node, std::size_t l, std::size_t r, std::size_t ql,
+                    std::size_t qr, std::size_t box) {
+            if (qr <= l || r <= ql)
+                return;
+            if (ql <= l && r <= qr) {
+                lists_[node].push_back(box);
+                return;
+            }
+            const std::size_t mid = l + (r - l) / 2;
+            insert(2 * node, l, mid, ql, qr, box);
+            insert(2 * node + 1, mid, r, ql, qr, box);
+        }
+
+      public:
+        StabbingTree(const std::vector<Scalar> &ys, std::size_t boxes)
+            : ys_(ys), lists_(4 * ys.size()), active_(boxes) {
+        }
+
+        void add(Scalar y0, Scalar y1, std::size_t box) {
+            const std::size_t l = std::lower_bound(ys_.begin(), ys_.end(), y0) - ys_.begin();
+            const std::size_t r = std::lower_bound(ys_.begin(), ys_.end(), y1) - ys_.begin();
+            insert(1, 0, ys_.size() - 1, l, r, box);
+            active_[box] = true;
+        }
+
+        void remove(std::size_t box) {
+            active_[box] = false;
+        }
+
+        // Calls report for every active box whose y range [y0, y1) contains y, which must
+        // be one of the coordinates below the largest one.
+        template <typename Report>
+        void stab(Scalar y, Report report) {
+            const std::size_t leaf = std::lower_bound(ys_.begin(), ys_.end(), y) - ys_.begin();
+            std::size_t node = 1, l = 0, r = ys_.size() - 1;
+            while (true) {
+                std::vector<std::size_t> &list = lists_[node];
+                for (std::size_t i = 0; i < list.size();) {
+                    if (active_[list[i]]) {
+                        report(list[i++]);
+                    } else {
+                        list[i] = list.back();
+                        list.pop_back();
+                    }
+                }
+                if (r - l == 1)
+                    return;
+                const std::size_t mid = l + (r - l) / 2;
+                if (leaf < mid) {
+                    node = 2 * node;
+                    r = mid;
+                } else {
+                    node = 2 * node + 1;
+                    l = mid;
+                }
+            }
+        }
+    };
+
+    // The distinct y coordinates of the boxes, sorted.
+    template <typename Scalar>
+    std::vector<Scalar> sorted_ys(const std::vector<Box<Scalar>> &boxes) {
+        std::vector<Scalar> ys;
+        ys.reserve(2 * boxes.size());
+        for (const Box<Scalar> &b : boxes) {
+            ys.push_back(b.y0);
+            ys.push_back(b.y1);
+        }
+        std::sort(ys.begin(), ys.end());
+        ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+        return ys;
+    }
+
+    template <typename Scalar>
+    BasicArea<Scalar> union_area_of(const std::vector<Box<Scalar>> &boxes) {
+        if (boxes.empty())
+            return 0;
+        const std::vector<Scalar> ys = sorted_ys(boxes);
+        CoverTree<Scalar> tree(ys);
+        const std::vector<Event> events = sorted_events(boxes);
+        BasicArea<Scalar> area = 0;
+        Scalar last_x = boxes[events.front().box].x0;
+        for (const Event &e : events) {
+            const Box<Scalar> &b = boxes[e.box];
+            const Scalar x = e.begins ? b.x0 : b.x1;
+            area += BasicArea<Scalar>(tree.covered()) * distance(last_x, x);
+            last_x = x;
+            tree.add(b.y0, b.y1, e.begins ? 1 : -1);
+        }
+        return area;
+    }
+
+    // Rectangles crossing the sweep line, ordered by their bottom edge.
+    using ActiveSet = std::set<std::pair<std::int64_t, std::size_t>>;
+
+    // Sweeps until the first overlap. While none has been found the active rectangles
+    // are pairwise disjoint, so only the neighbours of a new one need to be checked.
+    template <typename Scalar>
+    bool any_overlap_of(const std::vector<Box<Scalar>> &boxes, const std::atomic<bool> &stop) {
+        ActiveSet active;
+        std::size_t steps = 0;
+        for (const Event &e : sorted_events(boxes)) {
+            if (++steps % 4096 == 0 && stop.load(std::memory_order_relaxed))
+                return false;
+            const Box<Scalar> &b = boxes[e.box];
+            if (!e.begins) {
+                active.erase({b.y0, e.box});
+                continue;
+            }
+            const auto next = active.lower_bound({b.y0, 0});
+            if (next != active.end() && boxes[next->second].y0 < b.y1)
+                return true;
+            if (next != active.begin() && boxes[std::prev(next)->second].y1 > b.y0)
+                return true;
+            active.emplace_hint(next, b.y0, e.box);
+        }
+        return false;
+    }
+
+    // Splits the boxes into vertical slabs with about the same number of left edges,
+    // clipping every box to the slabs it crosses. A part of positive area shared by
+    // two boxes lies, at least partly, in a single slab.
+    template <typename Scalar>
+    std::vector<std::vector<Box<Scalar>>> split_into_slabs(const std::vector<Box<Scalar>> &boxes,
+                                                           std::size_t slabs) {
+        std::vector<Scalar> xs;
+        xs.reserve(boxes.size());
+        for (const Box<Scalar> &b : boxes)
+            xs.push_back(b.x0);
+        std::vector<Scalar> bounds;
+        for (std::size_t s = 1; s < slabs; ++s) {
+            auto nth = xs.begin() + xs.size() * s / slabs;
+            std::nth_element(xs.begin(), nth, xs.end());
+            bounds.push_back(*nth);
+        }
+        std::sort(bounds.begin(), bounds.end());
+
+        std::vector<std::vector<Box<Scalar>>> parts(slabs);
+        for (const Box<Scalar> &b : boxes) {
+            std::size_t s = std::upper_bound(bounds.begin(), bounds.end(), b.x0) - bounds.begin();
+            for (; s < slabs; ++s) {
+                Box<Scalar> part = b;
+                if (s > 0)
+                    part.x0 = std::max(part.x0, bounds[s - 1]);
+                if (s < bounds.size())
+                    part.x1 = std::min(part.x1, bounds[s]);
+                if (part.x0 < part.x1)
+                    parts[s].push_back(part);
+                if (s == bounds.size() || b.x1 <= bounds[s])
+                    break;
+            }
+        }
+        return parts;
+    }
+} // namespace
+
+template <typename Scalar>
+BasicArea<Scalar> union_area(const BasicRectangles<Scalar> &rects) {
+    return union_area_of(boxes_of(rects));
+}
+
+template <typename Scalar>
+BasicArea<Scalar> union_area(execution::sequenced_policy, const BasicRectangles<Scalar> &rects) {
+    return union_area(rects);
+}
+
+template <typename Scalar>
+BasicArea<Scalar> union_area(execution::parallel_policy, const BasicRectangles<Scalar> &rects) {
+    const std::size_t slabs = detail::chunk_count(rects.size(), 64);
+    if (slabs == 1)
+        return union_area(rects);
+    const auto parts = split_into_slabs(boxes_of(rects), slabs);
+    std::vector<BasicArea<Scalar>> areas(slabs);
+    detail::parallel_for_chunks(slabs, slabs, [&](std::size_t s, std::size_t, std::size_t) {
+        areas[s] = union_area_of(parts[s]);
+    });
+    BasicArea<Scalar> area = 0;
+    for (const BasicArea<Scalar> &a : areas)
+        area += a;
+    return area;
+}
+
+template <typename Scalar>
+bool any_overlap(const BasicRectangles<Scalar> &rects) {
+    const std::atomic<bool> never(false);
+    return any_overlap_of(boxes_of(rects), never);
+}
+
+template <typename Scalar>
+bool any_overlap(execution::sequenced_policy, const BasicRectangles<Scalar> &rects) {
+    return any_overlap(rects);
+}
+
+template <typename Scalar>
+bool any_overlap(execution::parallel_policy, const BasicRectangles<Scalar> &rects) {
+    const std::size_t slabs = detail::chunk_count(rects.size(), 64);
+    if (slabs == 1)
+        return any_overlap(rects);
+    const auto parts = split_into_slabs(boxes_of(rects), slabs);
+    std::atomic<bool> found(false);
+    detail::parallel_for_chunks(slabs, slabs, [&](std::size_t s, std::size_t, std::size_t) {
+        if (any_overlap_of(parts[s], found))
+            found.store(true, std::memory_order_relaxed);
+    });
+    return found.load();
+}
+
+template <typename Scalar>
+std::vector<std::pair<std::size_t, std::size_t>>
+intersecting_pairs(const BasicRectangles<Scalar> &rects) {
+    const std::vector<Box<Scalar>> boxes = boxes_of(rects);
+    std::vector<std::pair<std::size_t, std::size_t>> pairs;
+    if (boxes.empty())
+        return pairs;
+    const std::vector<Scalar> ys = sorted_ys(boxes);
+    StabbingTree<Scalar> containing(ys, boxes.size());
+    ActiveSet active;
+    for (const Event &e : sorted_events(boxes)) {
+        const Box<Scalar> &b = boxes[e.box];
+        if (!e.begins) {
+            active.erase({b.y0, e.box});
+            containing.remove(e.box);
+            continue;
+        }
+        auto report = [&](std::size_t other) {
+            pairs.emplace_back(std::min(other, e.box), std::max(other, e.box));
+        };
+        // An active rectangle overlaps b if it contains the bottom edge of b or begins
+        // above it and below the top edge; both queries visit only rectangles reported.
+        containing.stab(b.y0, report);
+        for (auto it = active.upper_bound({b.y0, std::numeric_limits<std::size_t>::max()});
+             it != active.end() && it->first < b.y1; ++it)
+            report(it->second);
+        active.emplace(b.y0, e.box);
+        containing.add(b.y0, b.y1, e.box);
+    }
+    return pairs;
+}
+
+#define GEOMETRY_INSTANTIATE(Scalar)                                                               \
+    template BasicArea<Scalar> union_area(const BasicRectangles<Scalar> &);                    \
+    template BasicArea<Scalar> union_area(execution::sequenced_policy,                         \
+                                          const BasicRectangles<Scalar> &);                    \
+    template BasicArea<Scalar> union_area(execution::parallel_policy,                          \
+                                          const BasicRectangles<Scalar> &);                    \
+    template bool any_overlap(const BasicRectangles<Scalar> &);                                \
+    template bool any_overlap(execution::sequenced_policy, const BasicRectangles<Scalar> &);   \
+    template bool any_overlap(execution::parallel_policy, const BasicRectangles<Scalar> &);    \
+    template std::vector<std::pair<std::size_t, std::size_t>> intersecting_pairs(              \
+        const BasicRectangles<Scalar> &);
+
+GEOMETRY_INSTANTIATE(std::int16_t)
+GEOMETRY_INSTANTIATE(std::int32_t)
+GEOMETRY_INSTANTIATE(std::int64_t)
@@ -0,0 +1,48 @@
+#ifndef GEOMETRY_GEOMETRY_OVERLAP_H
+#define GEOMETRY_GEOMETRY_OVERLAP_H
+
+#include "geometry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Sweep-line kernels relating the rectangles of a collection to each other.
+// As in RectangleIndex, a rectangle covers [x, x + width) x [y, y + height), so two
+// rectangles overlap only if they share a part of positive area.
+
+namespace detail {
+    __extension__ typedef unsigned __int128 uint128_t;
+} // namespace detail
+
+// Unsigned type wide enough for any area spanned by coordinates of type Scalar.
+template <typename Scalar>
+using BasicArea = std::conditional_t<(sizeof(Scalar) <= 4), std::uint64_t, detail::uint128_t>;
+
+using Area = BasicArea<std::int32_t>;
+
+// Area covered by the union of the rectangles, counting shared parts once. O(n log n).
+template <typename Scalar = std::int32_t>
+BasicArea<Scalar> union_area(const BasicRectangles<Scalar> &);
+template <typename Scalar = std::int32_t>
+BasicArea<Scalar> union_area(execution::sequenced_policy, const BasicRectangles<Scalar> &);
+template <typename Scalar = std::int32_t>
+BasicArea<Scalar> union_area(execution::parallel_policy, const BasicRectangles<Scalar> &);
+
+// Whether any two rectangles overlap. Stops at the first overlap found. O(n log n).
+template <typename Scalar = std::int32_t>
+bool any_overlap(const BasicRectangles<Scalar> &);
+template <typename Scalar = std::int32_t>
+bool any_overlap(execution::sequenced_policy, const BasicRectangles<Scalar> &);
+template <typename Scalar = std::int32_t>
+bool any_overlap(execution::parallel_policy, const BasicRectangles<Scalar> &);
+
+// All pairs (i, j), i < j, of overlapping rectangles, in no particular order.
+// O(n log n + k) for k pairs found.
+template <typename Scalar = std::int32_t>
+std::vector<std::pair<std::size_t, std::size_t>>
+intersecting_pairs(const BasicRectangles<Scalar> &);
+
+#endif // GEOMETRY_GEOMETRY_OVERLAP_H
@@ -0,0 +1,176 @@
+#include "geometry_parallel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    // The indices not yet taken from the share of one thread. The owner takes them
+    // from the front, thieves take the back half. Aligned, so that the ranges of
+    // different threads do not share a cache line.
+    struct alignas(64) TaskRange {
+        std::mutex mutex;
+        std::size_t begin = 0, end = 0;
+    };
+
+    struct Batch {
+        void (*task)(void *, std::size_t);
+        void *context;
+        std::size_t participants;
+        TaskRange *ranges;
+        std::atomic<std::size_t> remaining;
+    };
+
+    // Whether the thread is a worker of the pool or is running a batch on it.
+    thread_local bool inside_pool = false;
+
+    bool take(TaskRange &range, std::size_t &index) {
+        const std::lock_guard<std::mutex> lock(range.mutex);
+        if (range.begin == range.end)
+            return false;
+        index = range.begin++;
+        return true;
+    }
+
+    // Moves the back half of the indices of victim to thief, whose range is empty.
+    bool steal(TaskRange &victim, TaskRange &thief) {
+        std::size_t begin, end;
+        {
+            const std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin == victim.end)
+                return false;
+            end = victim.end;
+            begin = victim.end -= (victim.end - victim.begin + 1) / 2;
+        }
+        const std::lock_guard<std::mutex> lock(thief.mutex);
+        thief.begin = begin;
+        thief.end = end;
+        return true;
+    }
+
+    class Pool {
+        std::mutex mutex_;
+        std::condition_variable wake_, done_;
+        Batch *batch_ = nullptr;
+        std::uint64_t generation_ = 0;
+        // Workers that have joined the current batch and not left it yet.
+        std::size_t active_ = 0;
+        bool stopping_ = false;
+        // Held while a batch runs on the pool. Only then are the ranges, one for
+        // every participant, in use, so batches need not allocate their own.
+        std::mutex running_;
+        std::unique_ptr<TaskRange[]> ranges_;
+        std::vector<std::thread> workers_;
+
+      public:
+        Pool() {
+            const std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+            ranges_.reset(new TaskRange[threads]);
+            workers_.reserve(threads - 1);
+            for (std::size_t self = 1; self < threads; ++self)
+                workers_.emplace_back([this, self] { work(self); });
+        }
+
+        ~Pool() {
+            {
+                const std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            wake_.notify_all();
+            for (std::thread &worker : workers_)
+                worker.join();
+        }
+
+        std::size_t concurrency() const noexcept {
+            return workers_.size() + 1;
+        }
+
+        void run(std::size_t count, void (*task)(void *, std::size_t), void *context) {
+            if (count <= 1 || workers_.empty() || inside_pool || !running_.try_lock()) {
+                for (std::size_t i = 0; i < count; ++i)
+                    task(context, i);
+                return;
+            }
+            const std::lock_guard<std::mutex> running(running_, std::adopt_lock);
+
+            Batch batch{task, context, concurrency(), ranges_.get(), {count}};
+            for (std::size_t p = 0; p < batch.participants; ++p) {
+                batch.ranges[p].begin = count * p / batch.participants;
+                batch.ranges[p].end = count * (p + 1) / batch.participants;
+            }
+            {
+                const std::lock_guard<std::mutex> lock(mutex_);
+                batch_ = &batch;
+                ++generation_;
+            }
+            wake_.notify_all();
+
+            inside_pool = true;
+            participate(batch, 0);
+            inside_pool = false;
+
+            // The batch lives on this stack frame, so wait for the tasks stolen by the
+            // workers and then for the workers themselves to leave it.
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [&] { return batch.remaining.load() == 0; });
+            batch_ = nullptr;
+            done_.wait(lock, [&] { return active_ == 0; });
+        }
+
+      private:
+        void participate(Batch &batch, std::size_t self) {
+            TaskRange &own = batch.ranges[self];
+            for (;;) {
+                std::size_t index;
+                if (take(own, index)) {
+                    batch.task(batch.context, index);
+                    if (batch.remaining.fetch_sub(1) == 1) {
+                        const std::lock_guard<std::mutex> lock(mutex_);
+                        done_.notify_all();
+                    }
+                    continue;
+                }
+                bool stolen = false;
+                for (std::size_t k = 1; k < batch.participants && !stolen; ++k)
+                    stolen = steal(batch.ranges[(self + k) % batch.participants], own);
+                if (!stolen)
+                    return;
+            }
+        }
+
+        void work(std::size_t self) {
+            inside_pool = true;
+            std::uint64_t seen = 0;
+            std::unique_lock<std::mutex> lock(mutex_);
+            for (;;) {
+                wake_.wait(lock, [&] { return stopping_ || (batch_ && generation_ != seen); });
+                if (stopping_)
+                    return;
+                seen = generation_;
+                Batch &batch = *batch_;
+                ++active_;
+                lock.unlock();
+                participate(batch, self);
+                lock.lock();
+                if (--active_ == 0)
+                    done_.notify_all();
+            }
+        }
+    };
+
+    Pool &pool() {
+        static Pool instance;
+        return instance;
+    }
+} // namespace
+
+std::size_t detail::pool_concurrency() {
+    return pool().concurrency();
+}
+
+void detail::run_tasks(std::size_t count, void (*task)(void *, std::size_t), void *context) {
+    pool().run(count, task, context);
+}
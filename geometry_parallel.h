@@ -0,0 +1,65 @@
+#ifndef GEOMETRY_GEOMETRY_PARALLEL_H
+#define GEOMETRY_GEOMETRY_PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// Internal helpers shared by the parallel overloads of the geometry algorithms.
+namespace detail {
+    // Smallest number of elements worth handing over to a separate thread.
+    constexpr std::size_t parallel_grain = std::size_t(1) << 14;
+
+    // Threads that take part in a parallel call: the workers of the pool and the
+    // calling thread.
+    std::size_t pool_concurrency();
+
+    // Runs task(context, i) for every i in [0, count) on a process-wide pool of
+    // threads, started on first use, and on the calling thread. Every thread starts
+    // with an equal share of the indices and, when it runs out, steals half of the
+    // remaining share of another one. Returns when all tasks have finished.
+    //
+    // One call runs on the pool at a time; calls made meanwhile, from other threads
+    // or from inside a task, run their tasks on the calling thread.
+    void run_tasks(std::size_t count, void (*task)(void *, std::size_t), void *context);
+
+    // Number of chunks [0, n) is split into: at most per_thread for every thread of the
+    // pool and none smaller than parallel_grain.
+    inline std::size_t chunk_count(std::size_t n, std::size_t max_chunks,
+                                   std::size_t per_thread = 1) {
+        return std::max<std::size_t>(
+            1, std::min({per_thread * pool_concurrency(), max_chunks, n / parallel_grain}));
+    }
+
+    // Calls f(chunk, begin, end) for each of the contiguous chunks of [0, n) on the pool.
+    template <typename F>
+    void parallel_for_chunks(std::size_t n, std::size_t chunks, F f) {
+        auto run = [&](std::size_t c) { f(c, n * c / chunks, n * (c + 1) / chunks); };
+        run_tasks(
+            chunks,
+            [](void *context, std::size_t c) { (*static_cast<decltype(run) *>(context))(c); },
+            &run);
+    }
+
+    // Start of chunk c of count chunks of the n elements at data, moved forward to a
+    // cache-line boundary, so that threads writing neighbouring chunks never share a
+    // line. Chunk 0 starts at 0 and chunk count (the end) at n.
+    template <typename T>
+    std::size_t line_aligned_bound(const T *data, std::size_t n, std::size_t c,
+                                   std::size_t count) {
+        constexpr std::size_t line = 64;
+        if (c == 0 || c == count)
+            return c == 0 ? 0 : n;
+        const std::size_t address = reinterpret_cast<std::uintptr_t>(data);
+        if (sizeof(T) > line || line % sizeof(T) != 0 || address % sizeof(T) != 0)
+            return n * c / count;
+        const std::size_t per_line = line / sizeof(T);
+        const std::size_t skew = (line - address % line) % line / sizeof(T);
+        const std::size_t bound = n * c / count;
+        if (bound <= skew)
+            return std::min(skew, n);
+        return std::min(skew + (bound - skew + per_line - 1) / per_line * per_line, n);
+    }
+} // namespace detail
+
+#endif // GEOMETRY_GEOMETRY_PARALLEL_H
@@ -0,0 +1,260 @@
+#ifndef GEOMETRY_GEOMETRY_SMALL_H
+#define GEOMETRY_GEOMETRY_SMALL_H
+
+#include "geometry.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Collection of rectangles that keeps up to InlineCapacity of them in the object
+// itself and only allocates, from its memory resource, when it grows beyond that.
+// For the many collections of a handful of rectangles, copies and operator+ then
+// never touch the heap. It has the value semantics of Rectangles: copies keep the
+// resource of the original, moves take it over and leave the source empty. Copy
+// assignment keeps the resource of the collection assigned to, move assignment takes
+// over that of the other one. Moves are noexcept; moving an inline collection copies
+// its rectangles.
+template <typename Scalar, std::size_t InlineCapacity = 8>
+class BasicSmallRectangles {
+    static_assert(InlineCapacity > 0, "Use Rectangles for collections without inline storage.");
+
+  public:
+    using value_type = BasicRectangle<Scalar>;
+    using size_type = std::size_t;
+    using iterator = value_type *;
+    using const_iterator = const value_type *;
+
+    static constexpr size_type inline_capacity = InlineCapacity;
+
+  private:
+    static_assert(std::is_trivially_copyable_v<value_type>);
+
+    std::pmr::memory_resource *resource_;
+    value_type *data_;
+    size_type size_ = 0;
+    size_type capacity_ = InlineCapacity;
+    alignas(value_type) unsigned char inline_[InlineCapacity * sizeof(value_type)];
+
+    value_type *inline_data() noexcept {
+        return reinterpret_cast<value_type *>(inline_);
+    }
+
+    bool is_inline() const noexcept {
+        return capacity_ == InlineCapacity;
+    }
+
+    // Makes room for at least n rectangles, keeping the current ones.
+    void grow(size_type n) {
+        const size_type capacity = std::max(n, 2 * capacity_);
+        auto *data = static_cast<value_type *>(
+            resource_->allocate(capacity * sizeof(value_type), alignof(value_type)));
+        std::memcpy(static_cast<void *>(data), data_, size_ * sizeof(value_type));
+        deallocate();
+        data_ = data;
+        capacity_ = capacity;
+    }
+
+    void deallocate() noexcept {
+        if (!is_inline())
+            resource_->deallocate(data_, capacity_ * sizeof(value_type), alignof(value_type));
+    }
+
+    // Takes over the rectangles of other, which is left empty and inline.
+    void take(BasicSmallRectangles &other) noexcept {
+        resource_ = other.resource_;
+        size_ = other.size_;
+        capacity_ = other.capacity_;
+        if (other.is_inline()) {
+            data_ = inline_data();
+            std::memcpy(static_cast<void *>(data_), other.data_, size_ * sizeof(value_type));
+        } else {
+            data_ = other.data_;
+        }
+        other.data_ = other.inline_data();
+        other.size_ = 0;
+        other.capacity_ = InlineCapacity;
+    }
+
+  public:
+    explicit BasicSmallRectangles(
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource()) noexcept
+        : resource_(resource), data_(inline_data()) {
+    }
+
+    BasicSmallRectangles(std::initializer_list<value_type> il,
+                         std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : BasicSmallRectangles(resource) {
+        reserve(il.size());
+        for (const value_type &r : il)
+            push_back(r);
+    }
+
+    template <typename InputIt, typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+    BasicSmallRectangles(InputIt first, InputIt last,
+                         std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : BasicSmallRectangles(resource) {
+        for (; first != last; ++first)
+            push_back(*first);
+    }
+
+    BasicSmallRectangles(const BasicSmallRectangles &other)
+        : BasicSmallRectangles(other.resource_) {
+        reserve(other.size_);
+        std::memcpy(static_cast<void *>(data_), other.data_, other.size_ * sizeof(value_type));
+        size_ = other.size_;
+    }
+
+    // Copies into the inline storage or storage from the resource of this collection.
+    BasicSmallRectangles &operator=(const BasicSmallRectangles &other) {
+        if (this != &other) {
+            if (other.size_ > capacity_)
+                grow(other.size_);
+            std::memcpy(static_cast<void *>(data_), other.data_, other.size_ * sizeof(value_type));
+            size_ = other.size_;
+        }
+        return *this;
+    }
+
+    BasicSmallRectangles(BasicSmallRectangles &&other) noexcept {
+        take(other);
+    }
+
+    BasicSmallRectangles &operator=(BasicSmallRectangles &&other) noexcept {
+        // Take over the buffer together with its resource, as Rectangles does.
+        if (this != &other) {
+            deallocate();
+            take(other);
+        }
+        return *this;
+    }
+
+    ~BasicSmallRectangles() {
+        deallocate();
+    }
+
+    std::pmr::memory_resource *resource() const noexcept {
+        return resource_;
+    }
+
+    value_type &operator[](size_type n) {
+        GEOMETRY_ASSERT(n < size_, "Trying to access an element out of bounds.");
+        return data_[n];
+    }
+    const value_type &operator[](size_type n) const {
+        GEOMETRY_ASSERT(n < size_, "Trying to access an element out of bounds.");
+        return data_[n];
+    }
+
+    value_type *data() noexcept {
+        return data_;
+    }
+    const value_type *data() const noexcept {
+        return data_;
+    }
+    iterator begin() noexcept {
+        return data_;
+    }
+    iterator end() noexcept {
+        return data_ + size_;
+    }
+    const_iterator begin() const noexcept {
+        return data_;
+    }
+    const_iterator end() const noexcept {
+        return data_ + size_;
+    }
+
+    size_type size() const noexcept {
+        return size_;
+    }
+    bool empty() const noexcept {
+        return size_ == 0;
+    }
+    size_type capacity() const noexcept {
+        return capacity_;
+    }
+
+    // Whether the rectangles are stored in the object itself.
+    bool is_small() const noexcept {
+        return is_inline();
+    }
+
+    void reserve(size_type n) {
+        if (n > capacity_)
+            grow(n);
+    }
+
+    void clear() noexcept {
+        size_ = 0;
+    }
+
+    void push_back(const value_type &r) {
+        if (size_ == capacity_) {
+            // r may be one of the rectangles being moved.
+            const value_type copy = r;
+            grow(size_ + 1);
+            ::new (static_cast<void *>(data_ + size_++)) value_type(copy);
+        } else {
+            ::new (static_cast<void *>(data_ + size_++)) value_type(r);
+        }
+    }
+
+    template <typename... Args>
+    value_type &emplace_back(Args &&...args) {
+        push_back(value_type(std::forward<Args>(args)...));
+        return data_[size_ - 1];
+    }
+
+    BasicRectanglesView<Scalar> view() const noexcept {
+        return BasicRectanglesView<Scalar>(data_, size_);
+    }
+    operator BasicRectanglesView<Scalar>() const noexcept {
+        return view();
+    }
+
+    bool operator==(const BasicSmallRectangles &other) const {
+        return view() == other.view();
+    }
+
+    BasicSmallRectangles &operator+=(const BasicVector<Scalar> &v) {
+        for (value_type &r : *this)
+            r += v;
+        return *this;
+    }
+};
+
+template <std::size_t InlineCapacity = 8>
+using SmallRectangles = BasicSmallRectangles<std::int32_t, InlineCapacity>;
+
+// Taking the collection by value makes a + v on an rvalue reuse its storage.
+template <typename Scalar, std::size_t N>
+BasicSmallRectangles<Scalar, N> operator+(BasicSmallRectangles<Scalar, N> rects,
+                                          const BasicVector<Scalar> &v) {
+    rects += v;
+    return rects;
+}
+
+template <typename Scalar, std::size_t N>
+BasicSmallRectangles<Scalar, N> operator+(const BasicVector<Scalar> &v,
+                                          BasicSmallRectangles<Scalar, N> rects) {
+    rects += v;
+    return rects;
+}
+
+template <typename Scalar, std::size_t N>
+BasicRectangle<Scalar> merge_all(const BasicSmallRectangles<Scalar, N> &rects) {
+    return merge_all(rects.view());
+}
+
+template <typename Scalar, std::size_t N>
+BasicMergeResult<Scalar> try_merge_all(const BasicSmallRectangles<Scalar, N> &rects) {
+    return try_merge_all(rects.view());
+}
+
+#endif // GEOMETRY_GEOMETRY_SMALL_H
@@ -0,0 +1,118 @@
+#include "geometry_stats.h"
+
+#ifdef GEOMETRY_STATS
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace {
+    using detail::stats::Block;
+
+    void add(GeometryStats &stats, const Block &block) {
+        using namespace detail::stats;
+        auto get = [](const std::atomic<std::uint64_t> &value) {
+            return value.load(std::memory_order_relaxed);
+        };
+        stats.merge_calls += get(block.counters[merge_calls]);
+        stats.merge_failures += get(block.counters[merge_failures]);
+        stats.merged_rectangles += get(block.counters[merged_rectangles]);
+        stats.collection_copies += get(block.counters[collection_copies]);
+        stats.collection_moves += get(block.counters[collection_moves]);
+        stats.translate_calls += get(block.counters[translate_calls]);
+        stats.translated_rectangles += get(block.counters[translated_rectangles]);
+        stats.merge_nanoseconds += get(block.nanoseconds[merge_latency]);
+        stats.translate_nanoseconds += get(block.nanoseconds[translate_latency]);
+        for (std::size_t i = 0; i < GeometryStats::latency_buckets; ++i) {
+            stats.merge_latency[i] += get(block.buckets[merge_latency][i]);
+            stats.translate_latency[i] += get(block.buckets[translate_latency][i]);
+        }
+    }
+
+    void subtract(GeometryStats &stats, const GeometryStats &base) {
+        stats.merge_calls -= base.merge_calls;
+        stats.merge_failures -= base.merge_failures;
+        stats.merged_rectangles -= base.merged_rectangles;
+        stats.collection_copies -= base.collection_copies;
+        stats.collection_moves -= base.collection_moves;
+        stats.translate_calls -= base.translate_calls;
+        stats.translated_rectangles -= base.translated_rectangles;
+        stats.merge_nanoseconds -= base.merge_nanoseconds;
+        stats.translate_nanoseconds -= base.translate_nanoseconds;
+        for (std::size_t i = 0; i < GeometryStats::latency_buckets; ++i) {
+            stats.merge_latency[i] -= base.merge_latency[i];
+            stats.translate_latency[i] -= base.translate_latency[i];
+        }
+    }
+
+    // The blocks of running threads and the totals of exited ones. Since the blocks
+    // are only written by their threads, reset subtracts a baseline later instead of
+    // clearing them.
+    struct Registry {
+        std::mutex mutex;
+        std::vector<const Block *> live;
+        GeometryStats retired, baseline;
+
+        // Totals since the start, with mutex held.
+        GeometryStats total() const {
+            GeometryStats stats = retired;
+            for (const Block *block : live)
+                add(stats, *block);
+            return stats;
+        }
+    };
+
+    // Never destroyed, so that threads exiting after main can still retire their blocks.
+    Registry &registry() {
+        static Registry *instance = new Registry;
+        return *instance;
+    }
+
+    struct ThreadBlock {
+        Block block{};
+
+        ThreadBlock() {
+            Registry &r = registry();
+            const std::lock_guard<std::mutex> lock(r.mutex);
+            r.live.push_back(&block);
+        }
+
+        ~ThreadBlock() {
+            Registry &r = registry();
+            const std::lock_guard<std::mutex> lock(r.mutex);
+            add(r.retired, block);
+            r.live.erase(std::find(r.live.begin(), r.live.end(), &block));
+            detail::stats::thread_block = nullptr;
+        }
+    };
+} // namespace
+
+detail::stats::Block &detail::stats::register_thread() {
+    thread_local ThreadBlock instance;
+    return instance.block;
+}
+
+GeometryStats geometry_stats() {
+    Registry &r = registry();
+    const std::lock_guard<std::mutex> lock(r.mutex);
+    GeometryStats stats = r.total();
+    subtract(stats, r.baseline);
+    return stats;
+}
+
+void reset_geometry_stats() {
+    Registry &r = registry();
+    const std::lock_guard<std::mutex> lock(r.mutex);
+    r.baseline = r.total();
+}
+
+#else
+
+GeometryStats geometry_stats() {
+    return {};
+}
+
+void reset_geometry_stats() {
+}
+
+#endif // GEOMETRY_STATS
@@ -0,0 +1,146 @@
+#ifndef GEOMETRY_GEOMETRY_STATS_H
+#define GEOMETRY_GEOMETRY_STATS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Statistics of the geometry operations, collected only when everything, the library
+// and the code using it, is compiled with -DGEOMETRY_STATS. Otherwise the hooks in
+// the operations expand to nothing and geometry_stats() reports zeros.
+//
+// Every thread counts into its own block, which only it writes, so the operations
+// pay for plain loads and stores; geometry_stats() adds up the blocks on demand.
+// Timing a call reads the steady clock twice, which dominates the cost (tens of
+// nanoseconds) for collections of a few rectangles.
+
+#ifdef GEOMETRY_STATS
+#include <atomic>
+#include <chrono>
+#endif
+
+// Snapshot of the statistics, counted since the start or the last reset.
+struct GeometryStats {
+    // Bucket i of a histogram counts the calls that took [2^i, 2^(i + 1)) nanoseconds;
+    // the last one also counts all longer calls.
+    static constexpr std::size_t latency_buckets = 32;
+    using Histogram = std::array<std::uint64_t, latency_buckets>;
+
+    // Calls of try_merge_all and merge_all (of collections, views and translated
+    // expressions), those that found rectangles that cannot be merged, and the
+    // rectangles in all of them. Every chain of try_merge_chains counts as a call;
+    // the chains are not timed.
+    std::uint64_t merge_calls = 0;
+    std::uint64_t merge_failures = 0;
+    std::uint64_t merged_rectangles = 0;
+    std::uint64_t merge_nanoseconds = 0;
+    Histogram merge_latency{};
+
+    // Collections copied and moved, including those passed by value, e.g. to operator+.
+    std::uint64_t collection_copies = 0;
+    std::uint64_t collection_moves = 0;
+
+    // In-place translations of collections (operator+=, translate and the evaluation of
+    // rects + v) and the rectangles they moved.
+    std::uint64_t translate_calls = 0;
+    std::uint64_t translated_rectangles = 0;
+    std::uint64_t translate_nanoseconds = 0;
+    Histogram translate_latency{};
+};
+
+#ifdef GEOMETRY_STATS
+inline constexpr bool geometry_stats_enabled = true;
+#else
+inline constexpr bool geometry_stats_enabled = false;
+#endif
+
+// Adds up the statistics of all threads, including those that have exited.
+GeometryStats geometry_stats();
+
+// Starts counting from zero again.
+void reset_geometry_stats();
+
+#ifdef GEOMETRY_STATS
+
+namespace detail::stats {
+    enum Counter : std::size_t {
+        merge_calls,
+        merge_failures,
+        merged_rectangles,
+        collection_copies,
+        collection_moves,
+        translate_calls,
+        translated_rectangles,
+        counter_count
+    };
+
+    enum Latency : std::size_t { merge_latency, translate_latency, latency_count };
+
+    // The statistics of one thread. Only the thread writes them; the atomics let
+    // geometry_stats() read them meanwhile and cost no more than plain memory accesses.
+    struct alignas(64) Block {
+        std::atomic<std::uint64_t> counters[counter_count];
+        std::atomic<std::uint64_t> nanoseconds[latency_count];
+        std::atomic<std::uint64_t> buckets[latency_count][GeometryStats::latency_buckets];
+    };
+
+    // Registers a block for the calling thread, added to the retired totals when the
+    // thread exits.
+    Block &register_thread();
+
+    inline thread_local Block *thread_block = nullptr;
+
+    inline Block &local() {
+        if (__builtin_expect(thread_block == nullptr, 0))
+            thread_block = &register_thread();
+        return *thread_block;
+    }
+
+    inline void bump(std::atomic<std::uint64_t> &counter, std::uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    inline void add(Counter counter, std::uint64_t n) {
+        bump(local().counters[counter], n);
+    }
+
+    // Adds the time from its construction to its destruction to a latency histogram.
+    class Timer {
+        using clock = std::chrono::steady_clock;
+
+        Latency latency_;
+        clock::time_point start_;
+
+      public:
+        explicit Timer(Latency latency) : latency_(latency), start_(clock::now()) {
+        }
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+
+        ~Timer() {
+            const std::uint64_t ns = static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start_)
+                    .count());
+            const std::size_t bucket = ns < 2 ? 0 : 63 - __builtin_clzll(ns);
+            Block &block = local();
+            bump(block.nanoseconds[latency_], ns);
+            bump(block.buckets[latency_][bucket < GeometryStats::latency_buckets
+                                             ? bucket
+                                             : GeometryStats::latency_buckets - 1],
+                 1);
+        }
+    };
+} // namespace detail::stats
+
+#define GEOMETRY_STATS_ADD(counter, n) detail::stats::add(detail::stats::counter, (n))
+#define GEOMETRY_STATS_TIME(latency)                                                               \
+    const detail::stats::Timer geometry_stats_timer(detail::stats::latency)
+
+#else
+
+#define GEOMETRY_STATS_ADD(counter, n) static_cast<void>(0)
+#define GEOMETRY_STATS_TIME(latency) static_cast<void>(0)
+
+#endif // GEOMETRY_STATS
+
+#endif // GEOMETRY_GEOMETRY_STATS_H
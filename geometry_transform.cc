@@ -0,0 +1,74 @@
+#include "geometry_transform.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+    __extension__ typedef __int128 int128_t;
+
+    // Wide enough for s * u + t with s, u and t of type Scalar, so the results can be
+    // computed without overflow and range-checked afterwards.
+    template <typename Scalar>
+    using Wide = std::conditional_t<(sizeof(Scalar) <= 4), std::int64_t, int128_t>;
+
+    // The interval [u, u + extent) scaled by s and translated by t, as its new start
+    // and length. A negative s mirrors it, so the start comes from its far end.
+    template <typename Scalar>
+    void map_interval(Wide<Scalar> s, Wide<Scalar> t, Scalar u, Scalar extent,
+                      Wide<Scalar> &start, Wide<Scalar> &length) {
+        const Wide<Scalar> scaled = s * extent;
+        start = s * u + t + std::min<Wide<Scalar>>(scaled, 0);
+        length = scaled < 0 ? -scaled : scaled;
+    }
+
+    template <typename Scalar>
+    bool fits(Wide<Scalar> w) {
+        return w >= std::numeric_limits<Scalar>::min() && w <= std::numeric_limits<Scalar>::max();
+    }
+
+    // The batch kernel. Swap is a template parameter, so the loop body is the same
+    // for every rectangle and free of branches; overflow is collected in a flag and
+    // checked once at the end.
+    template <typename Scalar, bool Swap>
+    bool transform_all(BasicRectangle<Scalar> *rects, std::size_t n, Wide<Scalar> sx,
+                       Wide<Scalar> sy, Wide<Scalar> tx, Wide<Scalar> ty) {
+        bool overflow = false;
+        for (std::size_t i = 0; i < n; ++i) {
+            const BasicRectangle<Scalar> r = rects[i];
+            const Scalar u = Swap ? r.pos().y() : r.pos().x();
+            const Scalar v = Swap ? r.pos().x() : r.pos().y();
+            const Scalar du = Swap ? r.height() : r.width();
+            const Scalar dv = Swap ? r.width() : r.height();
+            Wide<Scalar> x, y, width, height;
+            map_interval<Scalar>(sx, tx, u, du, x, width);
+            map_interval<Scalar>(sy, ty, v, dv, y, height);
+            overflow |= !fits<Scalar>(x) | !fits<Scalar>(y) | !fits<Scalar>(width) |
+                        !fits<Scalar>(height);
+            rects[i] = BasicRectangle<Scalar>(static_cast<Scalar>(width),
+                                              static_cast<Scalar>(height),
+                                              {static_cast<Scalar>(x), static_cast<Scalar>(y)});
+        }
+        return overflow;
+    }
+} // namespace
+
+template <typename Scalar>
+BasicRectangle<Scalar> BasicTransform<Scalar>::operator()(const BasicRectangle<Scalar> &r) const {
+    BasicRectangle<Scalar> result = r;
+    const bool overflow = swap_ ? transform_all<Scalar, true>(&result, 1, sx_, sy_, tx_, ty_)
+                                : transform_all<Scalar, false>(&result, 1, sx_, sy_, tx_, ty_);
+    GEOMETRY_CHECK(!overflow, "Coordinate overflow");
+    return result;
+}
+
+template <typename Scalar>
+void BasicTransform<Scalar>::apply(BasicRectangles<Scalar> &rects) const {
+    const bool overflow =
+        swap_ ? transform_all<Scalar, true>(rects.data(), rects.size(), sx_, sy_, tx_, ty_)
+              : transform_all<Scalar, false>(rects.data(), rects.size(), sx_, sy_, tx_, ty_);
+    GEOMETRY_CHECK(!overflow, "Coordinate overflow");
+}
+
+template class BasicTransform<std::int16_t>;
+template class BasicTransform<std::int32_t>;
+template class BasicTransform<std::int64_t>;
@@ -0,0 +1,108 @@
+#ifndef GEOMETRY_GEOMETRY_TRANSFORM_H
+#define GEOMETRY_GEOMETRY_TRANSFORM_H
+
+#include "geometry.h"
+
+// Axis-aligned affine transforms: compositions of translations, the reflection
+// across x = y, rotations by multiples of 90 degrees about the origin and integer
+// scaling (negative factors mirror). Every such transform maps a point (x, y) to
+//
+//     (sx * u + tx, sy * v + ty),  where (u, v) = swap ? (y, x) : (x, y),
+//
+// so a chain of any length composes into a single transform of the same form and
+// a collection is transformed in one pass, without a collection per step.
+//
+// Rectangles are mapped as the areas they cover: the result is the rectangle whose
+// area is the image of the original one. Overflowing coordinates terminate.
+template <typename Scalar>
+class BasicTransform {
+    bool swap_ = false;
+    Scalar sx_ = 1, sy_ = 1, tx_ = 0, ty_ = 0;
+
+    constexpr BasicTransform(bool swap, Scalar sx, Scalar sy, Scalar tx, Scalar ty)
+        : swap_(swap), sx_(sx), sy_(sy), tx_(tx), ty_(ty) {
+    }
+
+  public:
+    // The identity.
+    constexpr BasicTransform() = default;
+    BasicTransform(const BasicTransform &) = default;
+    BasicTransform &operator=(const BasicTransform &) = default;
+    ~BasicTransform() = default;
+
+    static constexpr BasicTransform translation(const BasicVector<Scalar> &v) {
+        return BasicTransform(false, 1, 1, v.x(), v.y());
+    }
+
+    // Across the line x = y, like the reflection() members.
+    static constexpr BasicTransform reflection() {
+        return BasicTransform(true, 1, 1, 0, 0);
+    }
+
+    // Counterclockwise by quarter_turns * 90 degrees; negative values turn clockwise.
+    static constexpr BasicTransform rotation(int quarter_turns) {
+        switch (((quarter_turns % 4) + 4) % 4) {
+        case 1:
+            return BasicTransform(true, -1, 1, 0, 0);
+        case 2:
+            return BasicTransform(false, -1, -1, 0, 0);
+        case 3:
+            return BasicTransform(true, 1, -1, 0, 0);
+        default:
+            return BasicTransform();
+        }
+    }
+
+    // Both factors must be non-zero; scaling(-1, 1) mirrors across the y axis.
+    static constexpr BasicTransform scaling(Scalar sx, Scalar sy) {
+        GEOMETRY_CHECK(sx != 0 && sy != 0, "Scale factors must be non-zero");
+        return BasicTransform(false, sx, sy, 0, 0);
+    }
+
+    // This transform followed by next.
+    constexpr BasicTransform then(const BasicTransform &next) const {
+        // next sees the coordinates produced by this one, swapped if next swaps.
+        const Scalar su = next.swap_ ? sy_ : sx_, tu = next.swap_ ? ty_ : tx_;
+        const Scalar sv = next.swap_ ? sx_ : sy_, tv = next.swap_ ? tx_ : ty_;
+        return BasicTransform(
+            swap_ != next.swap_, detail::checked_mul(next.sx_, su),
+            detail::checked_mul(next.sy_, sv),
+            detail::checked_add(detail::checked_mul(next.sx_, tu), next.tx_),
+            detail::checked_add(detail::checked_mul(next.sy_, tv), next.ty_));
+    }
+
+    constexpr BasicPosition<Scalar> operator()(const BasicPosition<Scalar> &p) const {
+        const Scalar u = swap_ ? p.y() : p.x(), v = swap_ ? p.x() : p.y();
+        return BasicPosition<Scalar>(detail::checked_add(detail::checked_mul(sx_, u), tx_),
+                                     detail::checked_add(detail::checked_mul(sy_, v), ty_));
+    }
+
+    // Vectors are differences of positions, so they are not translated.
+    constexpr BasicVector<Scalar> operator()(const BasicVector<Scalar> &v) const {
+        const Scalar u = swap_ ? v.y() : v.x(), w = swap_ ? v.x() : v.y();
+        return BasicVector<Scalar>(detail::checked_mul(sx_, u), detail::checked_mul(sy_, w));
+    }
+
+    BasicRectangle<Scalar> operator()(const BasicRectangle<Scalar> &r) const;
+
+    // Transforms every rectangle of the collection in place, in a single pass.
+    void apply(BasicRectangles<Scalar> &rects) const;
+
+    BasicRectangles<Scalar> operator()(BasicRectangles<Scalar> rects) const {
+        apply(rects);
+        return rects;
+    }
+
+    constexpr bool operator==(const BasicTransform &other) const {
+        return swap_ == other.swap_ && sx_ == other.sx_ && sy_ == other.sy_ &&
+               tx_ == other.tx_ && ty_ == other.ty_;
+    }
+};
+
+using Transform = BasicTransform<std::int32_t>;
+
+extern template class BasicTransform<std::int16_t>;
+extern template class BasicTransform<std::int32_t>;
+extern template class BasicTransform<std::int64_t>;
+
+#endif // GEOMETRY_GEOMETRY_TRANSFORM_H
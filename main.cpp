@@ -1,4 +1,11 @@
 #include "geometry.h"
+#include "geometry_checksum.h"
+#include "geometry_index.h"
+#include "geometry_io.h"
+#include "geometry_overlap.h"
+#include "geometry_parallel.h"
+#include "geometry_small.h"
+#include "geometry_transform.h"
 #include <type_traits>
 #include <vector>
 #include <algorithm>
@@ -6,12 +13,56 @@
 #include <functional>
 #include <limits>
 #include <iostream>
+#include <iterator>
+#include <numeric>
+#include <unordered_set>
 
 #ifdef NDEBUG
 #undef NDEBUG
 #endif // NDEBUG
 
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <system_error>
+#include <thread>
+
+// Licznik alokacji na stercie, do sprawdzania, ze przenoszenie nie kopiuje.
+// Bez inline, zeby kompilator nie parowal operator new z std::free.
+static std::size_t allocations = 0;
+
+__attribute__((noinline)) void *operator new(std::size_t size) {
+    ++allocations;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void *operator new(std::size_t size, std::align_val_t align) {
+    ++allocations;
+    const std::size_t a = static_cast<std::size_t>(align);
+    if (void *p = std::aligned_alloc(a, (size + a - 1) / a * a + (size ? 0 : a)))
+        return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
 
 int main() {
     std::cout << "Starting testing procedure." << std::endl;
@@ -60,6 +111,26 @@ int main() {
     assert(std::is_destructible_v<Rectangle>);
     assert(std::is_destructible_v<Rectangles>);
 
+    // Brak vtable: typy wartosciowe sa trywialnie kopiowalne i maja standardowy uklad.
+    assert(!std::is_polymorphic_v<Position>);
+    assert(!std::is_polymorphic_v<Vector>);
+    assert(std::is_trivially_copyable_v<Position>);
+    assert(std::is_trivially_copyable_v<Vector>);
+    assert(std::is_trivially_copyable_v<Rectangle>);
+    assert(std::is_standard_layout_v<Position>);
+    assert(std::is_standard_layout_v<Vector>);
+    assert(std::is_standard_layout_v<Rectangle>);
+    assert(sizeof(Position) == 2 * sizeof(Position::ScalarType));
+    assert(sizeof(Vector) == 2 * sizeof(Vector::ScalarType));
+    assert(sizeof(Rectangle) == 4 * sizeof(Position::ScalarType));
+
+    // Konstrukcja w czasie kompilacji
+    constexpr Position cpos1{7, -3};
+    constexpr Vector cvec1(cpos1);
+    constexpr Rectangle crec1{2, 3, Position(cvec1)};
+    static_assert(crec1.pos().reflection().x() == -3);
+    static_assert(crec1.area() == 6);
+
     // Dzialanie konstuktora Vector(scalar, scalar).
     Vector vec3{-300, -400};
     Vector vec4{0, 999};
@@ -491,6 +562,1022 @@ int main() {
     // Rectangles& Rectangles::operator+=(const Vector&)
     assert((std::is_same_v<std::invoke_result_t<decltype(&Rectangles::operator+=), Rectangles, const Vector &>, Rectangles &>));
 
+// ------------- COLUMNAR -------------
+
+    ColumnarRectangles crecs1{Rectangle(8, 1, {-4, 8}),
+                              Rectangle(71, 23, {5, 6}),
+                              Rectangle(9, 15, {43, 12})};
+    const ColumnarRectangles crecs2(crs);
+
+    assert(crecs1.size() == 3);
+    assert(crecs1 == crecs2);
+    assert(crecs2[1] == Rectangle(71, 23, {5, 6}));
+
+    // Proxy referencje
+    crecs1[0] = Rectangle(3, 4, {1, 2});
+    assert(crecs1[0].width() == 3);
+    assert(crecs1[0].height() == 4);
+    assert(crecs1[0].pos() == Position(1, 2));
+    assert(crecs1[0].area() == 12);
+    assert(!(crecs1 == crecs2));
+    crecs1[0] = crecs2[0];
+    assert(crecs1 == crecs2);
+
+    crecs1 += Vector(1, -1);
+    assert(crecs1[2] == Rectangle(9, 15, {44, 11}));
+    assert(Vector(-1, 1) + std::move(crecs1) == crecs2);
+    assert(crecs2 + Vector(0, 0) == crecs2);
+
+// ------------- SZEROKOSC WSPOLRZEDNYCH -------------
+
+    assert(sizeof(Rectangle) == 4 * sizeof(int32_t));
+    assert(sizeof(BasicRectangle<int16_t>) == 8);
+    assert(sizeof(BasicRectangle<int64_t>) == 32);
+
+    const BasicRectangles<int16_t> srecs{BasicRectangle<int16_t>(2, 1),
+                                         BasicRectangle<int16_t>(2, 1, {0, 1})};
+    assert(merge_all(srecs + BasicVector<int16_t>(3, 3)) == BasicRectangle<int16_t>(2, 2, {3, 3}));
+
+    const int64_t big = int64_t(1) << 40;
+    BasicRectangles<int64_t> lrecs{BasicRectangle<int64_t>(big, 1),
+                                   BasicRectangle<int64_t>(1, 1, {big, 0})};
+    lrecs += BasicVector<int64_t>(big, -big);
+    assert(merge_all(lrecs) == BasicRectangle<int64_t>(big + 1, 1, {big, -big}));
+
+// ------------- PRZEPELNIENIE -------------
+
+    // Wyniki na granicy zakresu sa poprawne.
+    Rectangles orecs{Rectangle(1, 1, {maxScalar - 1, minScalar + 1})};
+    orecs += Vector(1, -1);
+    assert(orecs[0].pos() == Position(maxScalar, minScalar));
+    assert(Rectangle(65536, 32767).area() == 2147418112);
+
+// ------------- MERGE Z POLITYKA WYKONANIA -------------
+
+    const Rectangles mrecs{Rectangle(2, 1),
+                           Rectangle(2, 1, {0, 1}),
+                           Rectangle(2, 2, {2, 0}),
+                           Rectangle(4, 2, {0, 2}),
+                           Rectangle(2, 4, {4, 0}),
+                           Rectangle(6, 1, {0, 4})};
+    assert(merge_all(execution::seq, mrecs) == Rectangle(6, 5));
+    assert(merge_all(execution::par, mrecs) == Rectangle(6, 5));
+    assert(merge_all(execution::par, {Rectangle(2, 1, {1, 1})}) == Rectangle(2, 1, {1, 1}));
+
+    // Duze wejscia dzielone na wymuszona liczbe kawalkow, niezaleznie od liczby rdzeni.
+    {
+        // na przemian kolumna z prawej i wiersz u gory
+        Rectangles grid{Rectangle(1, 1)};
+        for (int32_t side = 1; grid.size() < 120001; ++side) {
+            grid.emplace_back(1, side, Position(side, 0));
+            grid.emplace_back(side + 1, 1, Position(0, side));
+        }
+        const std::size_t n = grid.size();
+        // 32-bitowe wspolrzedne sie nie przepelniaja, a 16-bitowe tak, w srodku
+        BasicRectangles<int16_t> narrow;
+        for (int32_t i = 0; i < 100000; ++i)
+            narrow.emplace_back(1, 1, BasicPosition<int16_t>(int16_t(std::min(i, 32767)), 0));
+
+        for (std::size_t chunks : {2, 3, 7, 64}) {
+            assert(detail::try_merge_all_chunked(RectanglesView(grid), chunks).merged ==
+                   merge_all(execution::seq, grid));
+            const BasicMergeResult<int16_t> wide_par =
+                detail::try_merge_all_chunked(BasicRectanglesView<int16_t>(narrow), chunks);
+            const BasicMergeResult<int16_t> wide_seq = try_merge_all(execution::seq, narrow);
+            assert(wide_par.failed_at == 32767 && wide_par.error == MergeError::overflow);
+            assert(wide_par.merged == wide_seq.merged && wide_par.failed_at == wide_seq.failed_at);
+
+            // porazki na granicach kawalkow, obok nich i w ostatnich kawalkach
+            std::vector<std::size_t> breaks{n - 1, n - 2, n - (n - 1) / chunks / 2};
+            for (std::size_t c = 1; c < chunks; ++c) {
+                const std::size_t bound = 1 + (n - 1) * c / chunks;
+                breaks.insert(breaks.end(), {bound - 1, bound, bound + 1});
+            }
+            for (std::size_t at : breaks) {
+                Rectangles broken = grid;
+                broken[at] += Vector(1, 0);
+                const MergeResult par = detail::try_merge_all_chunked(RectanglesView(broken), chunks);
+                const MergeResult seq = try_merge_all(execution::seq, broken);
+                assert(!par && par.failed_at == at && seq.failed_at == at);
+                assert(par.merged == seq.merged && par.error == seq.error);
+            }
+        }
+    }
+
+// ------------- TRY MERGE -------------
+
+    const MergeResult tm_ok = try_merge_all(mrecs);
+    assert(tm_ok);
+    assert(tm_ok.merged == Rectangle(6, 5));
+    assert(tm_ok.failed_at == MergeResult::npos);
+
+    const MergeResult tm_bad = try_merge_all({Rectangle(2, 1),
+                                              Rectangle(2, 1, {0, 1}),
+                                              Rectangle(2, 2, {2, 0}),
+                                              Rectangle(4, 2, {0, 2}),
+                                              Rectangle(2, 4, {3, 0}),
+                                              Rectangle(6, 1, {0, 4})});
+    assert(!tm_bad);
+    assert(tm_bad.failed_at == 4);
+    assert(tm_bad.merged == Rectangle(4, 4));
+
+    const MergeResult tm_par = try_merge_all(execution::par, {Rectangle(1, 1), Rectangle(1, 1, {2, 0})});
+    assert(!tm_par && tm_par.failed_at == 1 && tm_par.merged == Rectangle(1, 1));
+    assert(tm_par.error == MergeError::not_adjacent && tm_bad.error == MergeError::not_adjacent);
+
+    // Przepelnienie to porazka w danym miejscu, a nie zakonczenie programu.
+    {
+        const Rectangles high{Rectangle(1, 1), Rectangle(1, 10, {0, 1}),
+                              Rectangle(1, 10, {0, maxScalar - 5}), Rectangle(1, 10, {0, maxScalar - 4})};
+        const RectanglesView tail = RectanglesView(high).subview(2, 2);
+        for (const MergeResult &r : {try_merge_all(tail), try_merge_all(execution::par, tail)}) {
+            assert(!r && r.failed_at == 1 && r.error == MergeError::overflow);
+            assert(r.merged == Rectangle(1, 10, {0, maxScalar - 5}));
+        }
+        const MergeResult grown = try_merge_all({Rectangle(1, maxScalar - 1), Rectangle(1, 5, {0, maxScalar - 1})});
+        assert(!grown && grown.failed_at == 1 && grown.error == MergeError::overflow);
+
+        // gorna krawedz poza zakresem nie blokuje scalenia w poziomie
+        assert(merge_all({Rectangle(1, 10, {0, maxScalar - 5}), Rectangle(2, 10, {1, maxScalar - 5})}) ==
+               Rectangle(3, 10, {0, maxScalar - 5}));
+
+        const std::size_t offsets[] = {0, 2, 4};
+        std::allocator<MergeResult> storage;
+        MergeResult *results = storage.allocate(2);
+        assert(try_merge_chains(RectanglesView(high), offsets, 2, results) == 1);
+        assert(results[0].merged == Rectangle(1, 11) && results[0].error == MergeError::none);
+        assert(results[1].failed_at == 1 && results[1].error == MergeError::overflow);
+        storage.deallocate(results, 2);
+
+        StreamingMerger streaming;
+        streaming.push(tail);
+        IncrementalMerger incremental;
+        incremental.push(tail[0]);
+        incremental.push(tail[1]);
+        assert(streaming.result().error == MergeError::overflow && incremental.result().error == MergeError::overflow);
+        incremental.pop();
+        assert(incremental.result() && incremental.result().error == MergeError::none);
+
+        const MergeResult shifted = try_merge_all(high + Vector(0, 10));
+        assert(!shifted && shifted.failed_at == 2 && shifted.error == MergeError::overflow);
+        assert(shifted.merged == Rectangle(1, 11, {0, 10}));
+
+        const std::string path = "/tmp/geometry_test_overflow.bin";
+        save(path, tail);
+        const MergeResult from_file = try_merge_file(path);
+        assert(!from_file && from_file.failed_at == 1 && from_file.error == MergeError::overflow);
+        std::remove(path.c_str());
+    }
+
+// ------------- COALESCE -------------
+
+    // Kafelki 2x2 w dowolnej kolejnosci skladaja sie w jeden prostokat.
+    assert(coalesce({Rectangle(1, 1, {1, 1}),
+                     Rectangle(1, 1),
+                     Rectangle(1, 1, {0, 1}),
+                     Rectangle(1, 1, {1, 0})}) == Rectangles{Rectangle(2, 2)});
+
+    // Ksztalt L nie jest prostokatem; zostaja dwa kawalki.
+    const Rectangles lshape = coalesce({Rectangle(1, 1, {0, 1}),
+                                        Rectangle(1, 1, {1, 0}),
+                                        Rectangle(1, 1)});
+    assert(lshape.size() == 2);
+    assert(lshape[0].area() + lshape[1].area() == 3);
+
+    assert(coalesce(Rectangles{}).size() == 0);
+    assert(coalesce(crs) == crs);
+
+    // Schody: kazde scalenie odslania nastepne wzdluz drugiej osi, a kawalki ida od konca.
+    {
+        Rectangles stairs;
+        int32_t side_w = 1, side_h = 1;
+        stairs.emplace_back(1, 1);
+        for (int i = 0; i < 2000; ++i) {
+            if (i % 2 == 0)
+                stairs.emplace_back(1, side_h, Position(side_w++, 0));
+            else
+                stairs.emplace_back(side_w, 1, Position(0, side_h++));
+        }
+        std::reverse(stairs.begin(), stairs.end());
+        assert(coalesce(stairs) == Rectangles{Rectangle(side_w, side_h)});
+
+        // Przepelnienie nie konczy programu, pozostale scalenia sa wykonane
+        const Rectangles wide{Rectangle(maxScalar, 1, {-maxScalar, 0}), Rectangle(maxScalar, 1),
+                              Rectangle(1, 1, {0, 1}), Rectangle(1, 1, {1, 1})};
+        const CoalesceResult cres = try_coalesce(wide);
+        assert(!cres && cres.error == MergeError::overflow);
+        assert((cres.rectangles == Rectangles{Rectangle(maxScalar, 1, {-maxScalar, 0}),
+                                              Rectangle(maxScalar, 1), Rectangle(2, 1, {0, 1})}));
+        assert(try_coalesce(stairs) && try_coalesce(stairs).rectangles == coalesce(stairs));
+    }
+
+// ------------- INDEKS PRZESTRZENNY -------------
+
+    {
+        // Siatka 40x40 kafelkow 3x2, w ktorej co siodmy jest pominiety.
+        Rectangles::storage_type tiles;
+        for (int32_t i = 0; i < 40; ++i)
+            for (int32_t j = 0; j < 40; ++j)
+                if ((i * 40 + j) % 7 != 0)
+                    tiles.emplace_back(3, 2, Position(3 * i - 50, 2 * j + 10));
+        const Rectangles grid(std::move(tiles));
+        const RectangleIndex index(grid);
+        assert(index.size() == grid.size());
+
+        std::size_t out[64];
+        for (int32_t x = -52; x < 75; x += 5) {
+            for (int32_t y = 8; y < 95; y += 3) {
+                std::size_t expected = 0;
+                for (std::size_t i = 0; i < grid.size(); ++i) {
+                    const Rectangle &t = grid[i];
+                    if (t.pos().x() <= x && x < t.pos().x() + t.width() &&
+                        t.pos().y() <= y && y < t.pos().y() + t.height())
+                        ++expected;
+                }
+                const std::size_t found = index.query_point({x, y}, out, 64);
+                assert(found == expected);
+                for (std::size_t i = 0; i < found; ++i) {
+                    assert(grid[out[i]].pos().x() <= x && grid[out[i]].pos().y() <= y);
+                }
+            }
+        }
+
+        // Okno 6x4 na granicach kafelkow obejmuje 4 kafelki, z ktorych jeden pominieto.
+        const std::size_t in_window = index.query_window(Rectangle(6, 4, {-50, 10}), out, 64);
+        assert(in_window == 3);
+        assert(index.query_window(Rectangle(1000, 1000, {-500, -500}), out, 0) == grid.size());
+        assert(index.query_window(Rectangle(5, 5, {-60, 0}), out, 64) == 0);
+
+        // Najblizsze sasiedztwo
+        assert(index.nearest({-100, -100}, out, 1) == 1);
+        assert(grid[out[0]] == Rectangle(3, 2, {-47, 10}));
+        assert(index.nearest({0, 50}, out, 5) == 5);
+        assert(grid[out[0]].pos().x() <= 0 && 0 < grid[out[0]].pos().x() + 3);
+
+        const RectangleIndex empty_index{Rectangles{}};
+        assert(empty_index.query_point({0, 0}, out, 64) == 0);
+        assert(empty_index.nearest({0, 0}, out, 3) == 0);
+    }
+
+// ------------- POLE SUMY I NAKLADANIE -------------
+
+    {
+        const Rectangles layout{Rectangle(4, 4),
+                                Rectangle(4, 4, {2, 2}),
+                                Rectangle(2, 2, {10, 10}),
+                                Rectangle(1, 8, {3, -2})};
+        // 16 + 16 - 4 (wspolna czesc kwadratow) + 4 + 8 - 6 (pas nad kwadratami)
+        assert(union_area(layout) == 34);
+        assert(union_area(execution::par, layout) == 34);
+        assert(any_overlap(layout));
+        assert(any_overlap(execution::par, layout));
+
+        auto pairs = intersecting_pairs(layout);
+        std::sort(pairs.begin(), pairs.end());
+        assert((pairs == std::vector<std::pair<std::size_t, std::size_t>>{{0, 1}, {0, 3}, {1, 3}}));
+
+        // Kafelki stykajace sie krawedziami nie nachodza na siebie.
+        assert(!any_overlap(mrecs));
+        assert(intersecting_pairs(mrecs).empty());
+
+        // Duza siatka bez nakladania i porownanie z pelnym przegladem par.
+        Rectangles grid;
+        for (int32_t i = 0; i < 300; ++i)
+            for (int32_t j = 0; j < 300; ++j)
+                grid.emplace_back(1, 1, Position(i, j));
+        assert(intersecting_pairs(grid).empty());
+
+        Rectangles scattered;
+        for (int32_t i = 0; i < 400; ++i)
+            scattered.emplace_back(1 + i * 37 % 23, 1 + i * 53 % 19,
+                                   Position(i * 7919 % 97, i * 6271 % 89));
+        std::vector<std::pair<std::size_t, std::size_t>> expected;
+        for (std::size_t i = 0; i < scattered.size(); ++i)
+            for (std::size_t j = i + 1; j < scattered.size(); ++j) {
+                const Rectangle &a = scattered[i], &b = scattered[j];
+                if (a.pos().x() < b.pos().x() + b.width() && b.pos().x() < a.pos().x() + a.width() &&
+                    a.pos().y() < b.pos().y() + b.height() && b.pos().y() < a.pos().y() + a.height())
+                    expected.emplace_back(i, j);
+            }
+        pairs = intersecting_pairs(scattered);
+        std::sort(pairs.begin(), pairs.end());
+        assert(!expected.empty() && pairs == expected);
+        assert(union_area(mrecs) == 30);
+        assert(union_area(Rectangles{}) == 0);
+
+        const Rectangles extreme{Rectangle(maxScalar, maxScalar, {minScalar, minScalar}),
+                                 Rectangle(maxScalar, maxScalar, {0, 0})};
+        assert(union_area(extreme) == 2 * Area(maxScalar) * Area(maxScalar));
+    }
+
+// ------------- BUDOWANIE BEZ KOPIOWANIA -------------
+
+    {
+        Rectangles big;
+        big.reserve(1000);
+        std::size_t before = allocations;
+        for (int32_t i = 0; i < 1000; ++i)
+            big.emplace_back(1, 1, Position(i, 0));
+        big.push_back(Rectangle(2, 2));
+        assert(allocations == before + 1); // push_back poza zarezerwowanym miejscem
+        assert(big.size() == 1001);
+
+        // Przeniesione operandy operator+ nie alokuja.
+        before = allocations;
+        Rectangles moved1 = std::move(big) + Vector(1, 1);
+        Rectangles moved2 = Vector(-1, -1) + std::move(moved1);
+        assert(allocations == before);
+        assert(moved2.size() == 1001);
+        assert(moved2[5] == Rectangle(1, 1, {5, 0}));
+
+        // Przejecie bufora i oddanie go z powrotem.
+        before = allocations;
+        Rectangles::storage_type buffer = moved2.release();
+        Rectangles adopted(std::move(buffer));
+        assert(allocations == before);
+        assert(moved2.size() == 0 && adopted.size() == 1001);
+
+        // Dopisanie przeniesionej kolekcji do pustej przejmuje jej bufor.
+        Rectangles target;
+        before = allocations;
+        target.append(std::move(adopted));
+        assert(allocations == before);
+        assert(target.size() == 1001 && adopted.size() == 0);
+
+        // Konstrukcja z zakresu alokuje dokladnie raz.
+        const std::vector<Rectangle> source(100, Rectangle(3, 3));
+        before = allocations;
+        const Rectangles ranged(source.begin(), source.end());
+        assert(allocations == before + 1);
+        assert(ranged.size() == 100 && ranged[99] == Rectangle(3, 3));
+
+        target.append(ranged);
+        assert(target.size() == 1101 && target[1100] == Rectangle(3, 3));
+
+        // Dopisanie kolekcji do samej siebie.
+        Rectangles doubled{Rectangle(1, 1), Rectangle(2, 2, {1, 0})};
+        doubled.append(doubled);
+        assert((doubled == Rectangles{Rectangle(1, 1), Rectangle(2, 2, {1, 0}), Rectangle(1, 1),
+                                      Rectangle(2, 2, {1, 0})}));
+        target.append(target);
+        assert(target.size() == 2202 && target[2201] == Rectangle(3, 3) && target[1101] == target[0]);
+    }
+
+// ------------- ARENA -------------
+
+    {
+        MonotonicArena arena(1 << 16);
+        for (int round = 0; round < 3; ++round) {
+            const std::size_t before = allocations;
+            Rectangles local(arena.resource());
+            local.reserve(64);
+            for (int32_t i = 0; i < 64; ++i)
+                local.emplace_back(1, 1, Position(i, 0));
+            const Rectangles shifted = local + Vector(0, 1);   // kopia zostaje w arenie
+            const Rectangles copied = shifted;
+            Rectangles assigned;
+            assigned = std::move(local) + Vector(0, 2);        // przeniesienie zabiera arene
+            assert(shifted.resource() == arena.resource());
+            assert(copied.resource() == arena.resource());
+            assert(assigned.resource() == arena.resource());
+            assert(merge_all(shifted) == Rectangle(64, 1, {0, 1}));
+            assert(merge_all(assigned) == Rectangle(64, 1, {0, 2}));
+            assert(coalesce(copied).resource() == arena.resource());
+            assert(allocations == before);
+            arena.reset();
+        }
+
+        // Kopia do innego zasobu
+        Rectangles in_arena({Rectangle(1, 1)}, arena.resource());
+        const Rectangles on_heap(in_arena, std::pmr::new_delete_resource());
+        assert(on_heap == in_arena && on_heap.resource() != in_arena.resource());
+
+        // przypisanie kopii zostawia wlasny zasob
+        Rectangles target(std::pmr::new_delete_resource());
+        target = in_arena;
+        assert(target == in_arena && target.resource() == std::pmr::new_delete_resource());
+        SmallRectangles<1> small_target(std::pmr::new_delete_resource());
+        SmallRectangles<1> small_source({Rectangle(1, 1), Rectangle(1, 1, {1, 0})}, arena.resource());
+        small_target = small_source;
+        assert(small_target == small_source && small_target.resource() == std::pmr::new_delete_resource());
+
+        // dopisanie miedzy roznymi zasobami kopiuje, kazda kolekcja zostaje przy swoim
+        Rectangles arena_target(arena.resource());
+        Rectangles heap_source{Rectangle(1, 1), Rectangle(1, 1, {1, 0})};
+        arena_target.append(std::move(heap_source));
+        assert(arena_target.resource() == arena.resource() && heap_source.resource() != arena.resource());
+        assert(arena_target.size() == 2 && heap_source.empty());
+        Rectangles heap_target;
+        heap_target.append(std::move(arena_target));
+        assert(heap_target.resource() != arena.resource() && arena_target.resource() == arena.resource());
+        assert(merge_all(heap_target) == Rectangle(2, 1) && arena_target.empty());
+    }
+
+// ------------- ITERATORY I WIDOK -------------
+
+    {
+        static_assert(std::is_same_v<std::iterator_traits<Rectangles::iterator>::iterator_category,
+                                     std::random_access_iterator_tag>);
+        static_assert(std::is_trivially_copyable_v<RectanglesView>);
+
+        Rectangles row;
+        for (int32_t i = 0; i < 8; ++i)
+            row.emplace_back(1, 1 + i % 3, Position(7 - i, 0));
+        assert(row.data() == &row[0] && row.end() - row.begin() == 8);
+
+        // Algorytmy standardowe dzialaja bezposrednio na kolekcji
+        std::sort(row.begin(), row.end(), [](const Rectangle &a, const Rectangle &b) {
+            return a.pos().x() < b.pos().x();
+        });
+        assert(row[0].pos() == Position(0, 0) && row[7].pos() == Position(7, 0));
+        const int32_t total = std::accumulate(row.cbegin(), row.cend(), 0,
+            [](int32_t sum, const Rectangle &r) { return sum + r.area(); });
+        assert(total == 1 + 2 + 3 + 1 + 2 + 3 + 1 + 2);
+
+        for (Rectangle &r : row)
+            r = Rectangle(1, 1, r.pos());
+        std::transform(row.begin(), row.end(), row.begin(),
+                       [](const Rectangle &r) { return r + Vector(0, 5); });
+        assert(merge_all(row) == Rectangle(8, 1, {0, 5}));
+
+        // Widok nie kopiuje prostokatow
+        const RectanglesView view = row;
+        assert(view.data() == row.data() && view.size() == row.size());
+        const RectanglesView middle = view.subview(2, 3);
+        assert(middle.size() == 3 && middle[0] == row[2] && middle.end() == row.begin() + 5);
+        assert(std::equal(middle.begin(), middle.end(), row.begin() + 2));
+        assert(view.subview(8, 0).empty() && RectanglesView().empty());
+        assert(Rectangles(middle.begin(), middle.end()) ==
+               Rectangles({Rectangle(1, 1, {2, 5}), Rectangle(1, 1, {3, 5}),
+                           Rectangle(1, 1, {4, 5})}));
+    }
+
+// ------------- TRANSFORMACJE -------------
+
+    {
+        const Rectangle tr1(3, 2, {1, 4});
+        assert(Transform()(tr1) == tr1);
+        assert(Transform::translation(Vector(2, -1))(tr1) == tr1 + Vector(2, -1));
+        assert(Transform::reflection()(tr1) == tr1.reflection());
+        assert(Transform::reflection()(Position(1, 4)) == Position(4, 1));
+        // Obrot o 90 stopni: [1, 4) x [4, 6) przechodzi na (-6, -4] x [1, 4)
+        assert(Transform::rotation(1)(tr1) == Rectangle(2, 3, {-6, 1}));
+        assert(Transform::rotation(1)(Position(1, 4)) == Position(-4, 1));
+        assert(Transform::rotation(-1) == Transform::rotation(3));
+        assert(Transform::rotation(2)(Vector(1, 4)) == Vector(-1, -4));
+        assert(Transform::scaling(2, 3)(tr1) == Rectangle(6, 6, {2, 12}));
+        assert(Transform::scaling(-1, 1)(tr1) == Rectangle(3, 2, {-4, 4}));
+
+        // Zlozenie to jedna transformacja, rowna kolejnym krokom
+        const Transform steps[] = {Transform::translation(Vector(5, -2)), Transform::rotation(1),
+                                   Transform::scaling(2, -3), Transform::reflection(),
+                                   Transform::rotation(2), Transform::translation(Vector(-1, 7))};
+        Transform chain;
+        Rectangle stepwise = tr1;
+        for (const Transform &t : steps) {
+            chain = chain.then(t);
+            stepwise = t(stepwise);
+        }
+        assert(chain(tr1) == stepwise);
+        assert(Transform::rotation(1).then(Transform::rotation(1)).then(Transform::rotation(2)) ==
+               Transform());
+
+        Rectangles tgrid;
+        for (int32_t i = 0; i < 100; ++i)
+            tgrid.emplace_back(1 + i % 4, 1 + i % 7, Position(i * 3 - 150, 40 - i));
+        Rectangles expected;
+        for (const Rectangle &r : tgrid)
+            expected.push_back(chain(r));
+        const Rectangles *before = &tgrid;
+        chain.apply(tgrid);
+        assert(&tgrid == before && tgrid == expected);
+
+        // Odbicie calej kolekcji
+        const Rectangles trecs = {Rectangle(2, 1), Rectangle(1, 1, {2, 0})};
+        assert(trecs.reflection() == Rectangles({Rectangle(1, 2), Rectangle(1, 1, {0, 2})}));
+        assert(Transform::reflection()(trecs) == trecs.reflection());
+        assert(merge_all(trecs.reflection()) == merge_all(trecs).reflection());
+    }
+
+// ------------- LENIWE PRZESUNIECIA -------------
+
+    {
+        Rectangles lrecs;
+        for (int32_t i = 0; i < 500; ++i)
+            lrecs.emplace_back(1, 2, Position(i, -7));
+        const Vector lv1(3, 4), lv2(-10, 2), lv3(5, -5);
+
+        // Wynik identyczny z kolejnymi przesunieciami
+        Rectangles eager = lrecs;
+        eager += lv1;
+        eager += lv2;
+        eager += lv3;
+        const Rectangles lazy = lrecs + lv1 + lv2 + lv3;
+        assert(lazy == eager);
+        assert(lv1 + (lrecs + lv2) + lv3 == eager);
+        assert(lrecs + lv1 + lv2 + lv3 == eager);
+        static_assert(decltype(lrecs + lv1 + lv2 + lv3)::depth == 3);
+
+        // Widok nie liczy niczego, dopoki nie jest potrzebny
+        std::size_t before = allocations;
+        const auto expr = translated_view(lrecs, lv1) + lv2;
+        assert(allocations == before && expr.size() == 500);
+        assert(merge_all(expr) == Rectangle(500, 2, {-7, -1}));
+        assert(merge_all(translated_view(lrecs, lv3)) == merge_all(lrecs) + lv3);
+        const Rectangles eager12 = lrecs + lv1 + lv2;
+        before = allocations;
+        assert(expr == eager12 && !(expr == eager) && !(expr == Rectangles()));
+        assert(eager12 == expr && !(eager == expr) && !(Rectangles() == expr));
+        assert(allocations == before);
+
+        // Widok tylko patrzy na kolekcje, wiec widzi jej zmiany, a zwykle wyrazenie nie
+        Rectangles viewed = lrecs;
+        const auto shifted_view = translated_view(viewed, lv1);
+        const auto shifted_copy = viewed + lv1 + lv2;
+        viewed += lv2;
+        assert(shifted_view == eager12 && shifted_copy == eager12);
+        viewed.clear();
+        assert(shifted_copy == eager12 && shifted_copy.size() == 500);
+
+        // Przeniesiona kolekcja jest przesuwana w miejscu
+        Rectangles owned = lrecs;
+        const Rectangle *buffer = owned.data();
+        before = allocations;
+        const Rectangles shifted = lv1 + (std::move(owned) + lv2) + lv3;
+        assert(allocations == before && shifted.data() == buffer && shifted == eager);
+
+        // Blad scalania w tym samym miejscu co bez przesuniecia
+        lrecs[300] += Vector(0, 1);
+        const MergeResult lres = try_merge_all(lrecs + lv1 + lv2);
+        assert(!lres && lres.failed_at == 300 && lres.failed_at == try_merge_all(lrecs).failed_at);
+        assert(lres.merged == try_merge_all(lrecs).merged + lv1 + lv2);
+    }
+
+// ------------- PLIKI BINARNE -------------
+
+    {
+        const std::string path = "/tmp/geometry_test_rectangles.bin";
+        Rectangles frecs;
+        for (int32_t i = 0; i < 1000; ++i)
+            frecs.emplace_back(2, 3, Position(2 * i - 1000, 17));
+        save(path, frecs);
+
+        {
+            const MappedRectangles mapped(path);
+            assert(mapped.size() == 1000 && mapped[999] == frecs[999]);
+            assert(mapped == frecs && frecs == mapped && mapped.view() == frecs);
+            assert(merge_all(mapped) == Rectangle(2000, 3, {-1000, 17}));
+            assert(merge_all(execution::par, mapped.view()) == merge_all(frecs));
+            assert(try_merge_all(mapped) && try_merge_all(mapped.view()).merged == merge_all(frecs));
+
+            // Przesuniecie tworzy nowa kolekcje, plik zostaje bez zmian
+            const Rectangles shifted = mapped + Vector(1, 1) + Vector(0, -1);
+            assert(shifted == frecs + Vector(1, 0) && mapped == frecs);
+            assert(merge_all(Vector(5, 5) + mapped) == merge_all(frecs) + Vector(5, 5));
+        }
+        assert(load(path) == frecs);
+
+        // Inna szerokosc wspolrzednych
+        bool thrown = false;
+        try {
+            BasicMappedRectangles<int64_t> wide(path);
+        } catch (const FormatError &) {
+            thrown = true;
+        }
+        assert(thrown);
+
+        // Uszkodzony plik
+        std::FILE *f = std::fopen(path.c_str(), "r+b");
+        std::fseek(f, 100, SEEK_SET);
+        std::fputc(0x55, f);
+        std::fclose(f);
+        thrown = false;
+        try {
+            MappedRectangles corrupted(path);
+        } catch (const FormatError &) {
+            thrown = true;
+        }
+        assert(thrown);
+        assert(MappedRectangles(path, false).size() == 1000);
+
+        // Rekord o zerowej szerokosci, z poprawna suma kontrolna i bez sprawdzania sumy
+        const int32_t records[] = {1, 1, 0, 0, 0, 1, 1, 0};
+        const uint64_t header[] = {0x544345524d4f4547ULL, 0x0000000000040001ULL, 2,
+                                   detail::checksum(reinterpret_cast<const unsigned char *>(records), sizeof records)};
+        f = std::fopen(path.c_str(), "wb");
+        std::fwrite(header, sizeof header, 1, f);
+        std::fwrite(records, sizeof records, 1, f);
+        std::fclose(f);
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            thrown = false;
+            try {
+                if (attempt == 0)
+                    MappedRectangles invalid(path);
+                else if (attempt == 1)
+                    MappedRectangles invalid(path, false);
+                else if (attempt == 2)
+                    load(path);
+                else
+                    try_merge_file(path);
+            } catch (const FormatError &e) {
+                thrown = std::string(e.what()).find("index 1") != std::string::npos;
+            }
+            assert(thrown);
+        }
+
+        save(path, Rectangles());
+        assert(MappedRectangles(path).size() == 0 && load(path) == Rectangles());
+        std::remove(path.c_str());
+
+        thrown = false;
+        try {
+            MappedRectangles missing(path);
+        } catch (const std::system_error &) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+// ------------- SCALANIE STRUMIENIOWE -------------
+    {
+        // pojedynczo, zakresem i porcjami - jak try_merge_all
+        Rectangles row;
+        for (int i = 0; i < 100; ++i)
+            row.emplace_back(1, 2, Position(i, 0));
+        StreamingMerger one, range, batches;
+        for (const Rectangle &r : row)
+            one.push(r);
+        range.push(row.begin(), row.end());
+        const RectanglesView all = row;
+        for (std::size_t i = 0; i < all.size(); i += 30)
+            batches.push(all.subview(i, std::min<std::size_t>(30, all.size() - i)));
+        assert(one && range && batches && one.count() == 100 && batches.count() == 100);
+        assert(one.result().merged == Rectangle(100, 2, Position(0, 0)));
+        assert(range.result().merged == one.result().merged);
+        assert(batches.result().merged == one.result().merged);
+
+        // pierwszy blad zostaje, reszta jest tylko liczona
+        row[42] = Rectangle(1, 1, Position(42, 0));
+        StreamingMerger broken;
+        broken.push(all.subview(0, 40));
+        broken.push(all.subview(40, 60));
+        assert(!broken && broken.count() == 100);
+        assert(broken.result().failed_at == 42 && try_merge_all(row).failed_at == 42);
+        assert(broken.result().merged == Rectangle(42, 2, Position(0, 0)));
+        broken.push(Rectangle(1, 2, Position(100, 0)));
+        assert(broken.result().failed_at == 42 && broken.count() == 101);
+
+        // plik czytany kawalkami, dluzszy niz bufor
+        const std::string path = "/tmp/geometry_test_streaming.bin";
+        Rectangles column;
+        for (int i = 0; i < 10000; ++i)
+            column.emplace_back(3, 1, Position(-5, i));
+        save(path, column);
+        const MergeResult from_file = try_merge_file(path);
+        assert(from_file && from_file.merged == merge_all(column));
+        column[9999] = Rectangle(3, 1, Position(-4, 9999));
+        save(path, column);
+        assert(try_merge_file(path).failed_at == 9999);
+
+        std::FILE *f = std::fopen(path.c_str(), "r+b");
+        std::fseek(f, 32 + 16 * 5000, SEEK_SET);
+        std::fputc(0x55, f);
+        std::fclose(f);
+        bool thrown = false;
+        try {
+            try_merge_file(path);
+        } catch (const FormatError &) {
+            thrown = true;
+        }
+        assert(thrown);
+        std::remove(path.c_str());
+    }
+
+// ------------- SCALANIE PRZYROSTOWE -------------
+    {
+        // kazdy prefiks jak try_merge_all
+        Rectangles chain;
+        for (int i = 0; i < 50; ++i)
+            chain.emplace_back(2, 1, Position(0, i));
+        chain.emplace_back(1, 1, Position(5, 5));
+        for (int i = 0; i < 10; ++i)
+            chain.emplace_back(2, 1, Position(0, 50 + i));
+        IncrementalMerger merger;
+        assert(merger.empty() && merger);
+        for (std::size_t i = 0; i < chain.size(); ++i) {
+            merger.push(chain[i]);
+            const Rectangles prefix(chain.begin(), chain.begin() + i + 1);
+            const MergeResult expected = try_merge_all(prefix);
+            assert(merger.result().merged == expected.merged);
+            assert(merger.result().failed_at == expected.failed_at);
+        }
+        assert(!merger && merger.size() == 61 && merger.result().failed_at == 50);
+
+        // cofanie az do bledu i dalej
+        for (int i = 0; i < 10; ++i)
+            merger.pop();
+        assert(!merger && merger.size() == 51);
+        merger.pop();
+        assert(merger && merger.result().merged == Rectangle(2, 50, Position(0, 0)));
+        merger.push(Rectangle(2, 3, Position(0, 50)));
+        assert(merger.result().merged == Rectangle(2, 53, Position(0, 0)));
+        while (merger.size() > 1)
+            merger.pop();
+        assert(merger.result().merged == chain[0]);
+        merger.pop();
+        assert(merger.empty());
+
+        merger.push(Rectangle(1, 1, Position(7, 7)));
+        merger.clear();
+        assert(merger.empty() && merger);
+    }
+
+// ------------- HASZOWANIE I SORTOWANIE -------------
+    {
+        // porzadek leksykograficzny
+        assert(Position(1, 5) < Position(2, 0) && Position(1, 0) < Position(1, 5));
+        assert(!(Position(1, 5) < Position(1, 5)) && Vector(-3, 9) < Vector(0, 0));
+        assert(Rectangle(9, 9, {0, 0}) < Rectangle(1, 1, {0, 1}));
+        assert(Rectangle(1, 9, {2, 2}) < Rectangle(2, 1, {2, 2}));
+        assert(Rectangle(2, 1, {2, 2}) < Rectangle(2, 3, {2, 2}));
+
+        // hasze zgodne z ==, rozne dla roznych obiektow
+        std::unordered_set<Rectangle> seen;
+        std::unordered_set<Position> positions;
+        for (int x = -20; x < 20; ++x) {
+            for (int y = -20; y < 20; ++y) {
+                seen.insert(Rectangle(1, 1, {x, y}));
+                seen.insert(Rectangle(1, 1, {x, y}));
+                positions.insert(Position(x, y));
+            }
+        }
+        assert(seen.size() == 1600 && positions.size() == 1600);
+        assert(seen.count(Rectangle(1, 1, {-20, 19})) && !seen.count(Rectangle(2, 1, {0, 0})));
+        assert(std::hash<Vector>()(Vector(1, 2)) == std::hash<Vector>()(Vector(1, 2)));
+        assert(std::hash<Vector>()(Vector(1, 2)) != std::hash<Vector>()(Vector(2, 1)));
+
+        // sortowanie pozycyjne jak std::sort, takze z ujemnymi i skrajnymi wspolrzednymi
+        auto check_sort = [](auto rects) {
+            auto expected = rects;
+            std::sort(expected.begin(), expected.end());
+            rects.sort();
+            assert(rects == expected);
+            expected.clear();
+            std::unique_copy(rects.begin(), rects.end(), std::back_inserter(expected));
+            rects.deduplicate();
+            assert(rects == expected);
+        };
+        std::uint64_t state = 12345;
+        auto next = [&state](std::int64_t range) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            return static_cast<std::int64_t>((state >> 33) % range) - range / 2;
+        };
+        for (std::size_t n : {std::size_t(0), std::size_t(100), std::size_t(5000)}) {
+            Rectangles small_values, large_values;
+            BasicRectangles<std::int16_t> narrow;
+            BasicRectangles<std::int64_t> wide;
+            for (std::size_t i = 0; i < n; ++i) {
+                small_values.emplace_back(1 + next(4) + 2, 1, Position(next(40), next(40)));
+                large_values.emplace_back(1 + next(1000) + 500, 1 + next(4) + 2,
+                                          Position(next(maxScalar), next(maxScalar)));
+                narrow.emplace_back(2, 3, BasicPosition<std::int16_t>(next(60000), next(10)));
+                wide.emplace_back(1, 1, BasicPosition<std::int64_t>(next(1LL << 62), next(3)));
+            }
+            large_values.emplace_back(maxScalar, maxScalar, Position(minScalar, maxScalar));
+            large_values.emplace_back(1, 1, Position(minScalar, minScalar));
+            check_sort(small_values);
+            check_sort(large_values);
+            check_sort(narrow);
+            check_sort(wide);
+        }
+    }
+
+// ------------- ROWNOSC I ODCISK -------------
+    {
+        Rectangles a;
+        for (int i = 0; i < 1000; ++i)
+            a.emplace_back(1 + i % 3, 2, Position(i, -i));
+        Rectangles b = a;
+        assert(a == b && a.fingerprint() == b.fingerprint());
+        assert(Rectangles().fingerprint() != 0 && Rectangles() == Rectangles());
+
+        // kazda zmiana uniewaznia odcisk
+        const std::uint64_t before = a.fingerprint();
+        b[999] = Rectangle(7, 7);
+        assert(b.fingerprint() != before && !(a == b) && !(b == a));
+        b[999] = a[999];
+        assert(b.fingerprint() == before && a == b);
+        b += Vector(1, 0);
+        assert(b.fingerprint() != before && !(a == b));
+        b += Vector(-1, 0);
+        assert(a == b);
+        b.data()[0] = Rectangle(5, 5);
+        assert(!(a == b) && b.fingerprint() != before);
+        b.push_back(Rectangle(1, 1));
+        b.clear();
+        b.append(a);
+        assert(a == b && b.fingerprint() == before);
+
+        // kopie i przeniesienia zabieraja odcisk, przeniesiony obiekt go traci
+        Rectangles moved = std::move(b);
+        assert(moved.fingerprint() == before && moved == a);
+        Rectangles assigned;
+        assigned = moved;
+        assert(assigned == a && assigned.fingerprint() == before);
+
+        // zmiana przez wczesniej pobrany wskaznik nie myli porownania
+        Rectangle *stale = assigned.data();
+        *stale = Rectangle(9, 9);
+        assert(assigned.fingerprint() != before && !(assigned == a));
+        *stale = a[0];
+        assert(assigned == a && a == assigned);
+
+        // bez odciskow porownanie bajtow
+        const Rectangles c(a.begin(), a.end());
+        Rectangles d(a.begin(), a.end());
+        d[500] = Rectangle(1, 2, Position(500, -499));
+        assert(c == Rectangles(a.begin(), a.end()) && !(c == d));
+        assert(RectanglesView(c) == RectanglesView(a) && !(RectanglesView(c) == RectanglesView(d)));
+    }
+
+// ------------- ROWNOLEGLE PRZESUNIECIA -------------
+    {
+        // wynik taki sam jak += dla malych i duzych kolekcji
+        for (std::size_t n : {std::size_t(0), std::size_t(10), std::size_t(300001)}) {
+            Rectangles a;
+            for (std::size_t i = 0; i < n; ++i)
+                a.emplace_back(1 + int(i % 5), 2, Position(int(i), -int(i % 11)));
+            Rectangles b = a;
+            a.translate(execution::par, Vector(-7, 3));
+            b += Vector(-7, 3);
+            assert(a == b);
+            b.translate(execution::seq, Vector(7, -3));
+            a.translate(execution::par, Vector(7, -3));
+            assert(a == b);
+
+            // przeniesiony operand nie jest kopiowany
+            const std::size_t before = allocations;
+            const Rectangle *buffer = a.data();
+            const Rectangles c = translated(execution::par, std::move(a), Vector(0, 1));
+            assert(c.data() == buffer && c.size() == n);
+            assert(allocations == before);
+            const Rectangles d = translated(execution::seq, b, Vector(0, 1));
+            assert(c == d && b.size() == n);
+        }
+    }
+
+// ------------- CONSTEXPR -------------
+    {
+        // obiekty i operacje w czasie kompilacji
+        static_assert(Position(1, 2) + Vector(3, 4) == Position(4, 6));
+        static_assert(Vector(3, 4) + Rectangle(1, 1) == Rectangle(1, 1, {3, 4}));
+        static_assert(merge_horizontally(Rectangle(2, 1), Rectangle(2, 3, {0, 1})) ==
+                      Rectangle(2, 4));
+        static_assert(merge_vertically(Rectangle(1, 2), Rectangle(3, 2, {1, 0})) ==
+                      Rectangle(4, 2));
+
+        // uklad ustalony w czasie kompilacji
+        constexpr FixedRectangles<8> layout{Rectangle(2, 1), Rectangle(2, 1, {0, 1}),
+                                            Rectangle(3, 2, {2, 0}), Rectangle(5, 4, {0, 2})};
+        static_assert(layout.size() == 4 && layout.capacity() == 8);
+        static_assert(merge_all(layout) == Rectangle(5, 6));
+        constexpr FixedRectangles<8> shifted = layout + Vector(10, 20);
+        static_assert(merge_all(shifted) == Rectangle(5, 6, {10, 20}));
+        static_assert(try_merge_all(FixedRectangles<2>{Rectangle(1, 1), Rectangle(2, 2, {5, 5})})
+                          .failed_at == 1);
+
+        // ten sam uklad w czasie wykonania
+        FixedRectangles<8> copy = layout;
+        copy.push_back(Rectangle(5, 1, {0, 6}));
+        assert(merge_all(copy) == Rectangle(5, 7));
+        const RectanglesView view = copy;
+        assert(view.size() == 5 && merge_all(view) == merge_all(copy));
+        assert(Rectangles(copy.begin(), copy.end()) == view);
+        assert(!(copy == layout) && layout + Vector(0, 0) == layout);
+    }
+
+// ------------- MALE KOLEKCJE -------------
+    {
+        // do pojemnosci bez alokacji
+        std::size_t before = allocations;
+        SmallRectangles<4> small{Rectangle(1, 1), Rectangle(1, 1, {1, 0}), Rectangle(2, 1, {0, 1})};
+        small.push_back(Rectangle(2, 2, {0, 2}));
+        SmallRectangles<4> copy = small;
+        const SmallRectangles<4> shifted = small + Vector(3, 3);
+        const SmallRectangles<4> reversed = Vector(-3, -3) + shifted;
+        assert(allocations == before && small.is_small() && copy.size() == 4);
+        assert(merge_all(small) == Rectangle(2, 4) && reversed == small);
+        assert(merge_all(shifted) == Rectangle(2, 4, {3, 3}));
+        assert(try_merge_all(SmallRectangles<>{Rectangle(1, 1), Rectangle(3, 3, {4, 4})}).failed_at == 1);
+
+        // powyzej pojemnosci na stercie, z tymi samymi wartosciami
+        small.push_back(Rectangle(2, 1, {0, 4}));
+        assert(allocations == before + 1 && !small.is_small() && small.capacity() >= 5);
+        assert(merge_all(small) == Rectangle(2, 5) && !(small == copy));
+        small.push_back(small[0]);
+        assert(small.size() == 6 && small[5] == Rectangle(1, 1));
+
+        // przenoszenie bez wyjatkow, bez kopiowania bufora na stercie
+        static_assert(std::is_nothrow_move_constructible_v<SmallRectangles<4>> &&
+                      std::is_nothrow_move_assignable_v<SmallRectangles<4>>);
+        const Rectangle *buffer = small.data();
+        before = allocations;
+        SmallRectangles<4> moved = std::move(small) + Vector(1, 0);
+        assert(moved.data() == buffer && allocations == before && small.empty());
+        copy = std::move(moved);
+        assert(copy.data() == buffer && copy.size() == 6 && moved.empty() && moved.is_small());
+        moved = copy;
+        assert(moved == copy && moved.data() != copy.data());
+
+        // kolekcja w arenie zostaje w arenie
+        MonotonicArena arena(1 << 12);
+        SmallRectangles<2> in_arena(arena.resource());
+        for (int i = 0; i < 10; ++i)
+            in_arena.emplace_back(1, 1, Position(i, 0));
+        assert(in_arena.resource() == arena.resource() && merge_all(in_arena) == Rectangle(10, 1));
+        const SmallRectangles<2> arena_copy = in_arena;
+        assert(arena_copy.resource() == arena.resource() && arena_copy == in_arena);
+    }
+
+// ------------- STATYSTYKI -------------
+    {
+        reset_geometry_stats();
+        Rectangles counted{Rectangle(1, 1), Rectangle(1, 1, {1, 0})};
+        assert(merge_all(counted) == Rectangle(2, 1));
+        assert(!try_merge_all(Rectangles{Rectangle(1, 1), Rectangle(1, 1, {5, 5})}));
+        const Rectangles copied = counted;
+        Rectangles moved = std::move(counted);
+        moved += Vector(1, 1);
+        const Rectangles shifted = copied + Vector(2, 0);
+        assert(merge_all(translated_view(shifted, Vector(1, 0))) == Rectangle(2, 1, {3, 0}));
+        std::thread([&] { assert(merge_all(copied) == Rectangle(2, 1)); }).join();
+
+        const GeometryStats stats = geometry_stats();
+        auto total = [](const GeometryStats::Histogram &h) {
+            return std::accumulate(h.begin(), h.end(), std::uint64_t(0));
+        };
+        if constexpr (geometry_stats_enabled) {
+            // liczniki watku, ktory juz sie zakonczyl, tez sie licza
+            assert(stats.merge_calls == 4 && stats.merge_failures == 1);
+            assert(stats.merged_rectangles == 8 && total(stats.merge_latency) == 4);
+            assert(stats.collection_copies == 2 && stats.collection_moves >= 1);
+            assert(stats.translate_calls == 2 && stats.translated_rectangles == 4);
+            assert(total(stats.translate_latency) == 2);
+            reset_geometry_stats();
+            assert(geometry_stats().merge_calls == 0 && geometry_stats().collection_copies == 0);
+        } else {
+            // bez GEOMETRY_STATS nic nie jest liczone
+            assert(stats.merge_calls == 0 && stats.collection_copies == 0);
+            assert(stats.translated_rectangles == 0 && total(stats.merge_latency) == 0);
+        }
+    }
+
+// ------------- SCALANIE WIELU LANCUCHOW -------------
+    {
+        // trzy lancuchy w jednym buforze, srodkowy sie nie scala
+        const Rectangles flat{Rectangle(1, 1), Rectangle(1, 1, {1, 0}),
+                              Rectangle(2, 2, {5, 5}), Rectangle(2, 1, {5, 7}), Rectangle(1, 1),
+                              Rectangle(3, 3, {-4, 0})};
+        const std::size_t offsets[] = {0, 2, 5, 6};
+        std::allocator<MergeResult> storage;
+        MergeResult *results = storage.allocate(3);
+        assert(try_merge_chains(RectanglesView(flat), offsets, 3, results) == 1);
+        assert(results[0].merged == Rectangle(2, 1) && results[0]);
+        assert(results[1].merged == Rectangle(2, 3, {5, 5}) && results[1].failed_at == 2);
+        assert(results[1].error == MergeError::not_adjacent);
+        assert(results[2].merged == Rectangle(3, 3, {-4, 0}) && results[2]);
+        assert(try_merge_chains(RectanglesView(flat), offsets, 0, results) == 0);
+        storage.deallocate(results, 3);
+
+        // duzo lancuchow rownolegle, tak jak try_merge_all kazdego z osobna
+        Rectangles chains;
+        std::vector<std::size_t> bounds{0};
+        for (std::int32_t c = 0; bounds.back() < 300000; ++c) {
+            const std::int32_t length = 1 + c % 9;
+            for (std::int32_t i = 0; i < length; ++i)
+                chains.emplace_back(1, 1, Position(c % 5 == 0 && i == 4 ? i + 1 : i, c));
+            bounds.push_back(chains.size());
+        }
+        const std::size_t count = bounds.size() - 1;
+        MergeResult *seq_results = storage.allocate(count), *par_results = storage.allocate(count);
+        const std::size_t failures = try_merge_chains(execution::seq, RectanglesView(chains),
+                                                      bounds.data(), count, seq_results);
+        assert(try_merge_chains(execution::par, RectanglesView(chains), bounds.data(), count,
+                                par_results) == failures);
+        auto same = [](const MergeResult &a, const MergeResult &b) {
+            return a.merged == b.merged && a.failed_at == b.failed_at && a.error == b.error;
+        };
+        assert(std::equal(seq_results, seq_results + count, par_results, same) && failures > 0);
+        for (std::size_t c = 0; c < count; c += 97) {
+            const MergeResult one = try_merge_all(RectanglesView(chains).subview(bounds[c], bounds[c + 1] - bounds[c]));
+            assert(same(one, par_results[c]));
+        }
+        storage.deallocate(seq_results, count);
+        storage.deallocate(par_results, count);
+    }
+
+    // DNC: static_assert(merge_all(FixedRectangles<2>{Rectangle(1, 1), Rectangle(2, 2, {5, 5})}) == Rectangle(1, 1));
+    // DNC: constexpr FixedRectangles<1> full{Rectangle(1, 1), Rectangle(1, 1)};
     // DNC: pos27 = vec26;
     // DNC: vec26 = pos27;
     // DNC: Position pos28 = vec27;
@@ -500,6 +1587,7 @@ int main() {
 
     // DNR: recs3[3];
     // DNR: recs4[3];
+    // DNR: RectanglesView(recs4).subview(1, 3);
     // DNR: Rectangle rec3{0, 0};
     // DNR: Rectangle rec4{3, 0};
     // DNR: Rectangle rec5{0, 5};
@@ -511,6 +1599,20 @@ int main() {
     // DNR: merge_vertically(mr5, mr7);
     // DNR: merge_vertically(mr5, mr7);
 
+    // DNR: Position(maxScalar, 0) + Vector(1, 0);
+    // DNR: Vector(minScalar, 0) + Vector(-1, 0);
+    // DNR: Rectangle(65536, 65536).area();
+    // DNR: orecs += Vector(1, 0);
+    // DNR: merge_all(orecs + Vector(1, 0) + Vector(-1, 0));
+    // DNR: merge_vertically(Rectangle(maxScalar, 1), Rectangle(1, 1, {maxScalar, 0}));
+    // DNR: Transform::scaling(0, 1);
+    // DNR: Transform::scaling(2, 1)(Rectangle(1, 1, {maxScalar / 2 + 1, 0}));
+    // DNR: StreamingMerger().result();
+    // DNR: IncrementalMerger().pop();
+    // DNR: try_merge_chains(RectanglesView(flat), std::array<std::size_t, 2>{1, 1}.data(), 1, results);
+    // DNR: try_merge_chains(RectanglesView(flat), std::array<std::size_t, 3>{0, 3, 2}.data(), 2, results);
+    // DNR: try_merge_chains(RectanglesView(flat), std::array<std::size_t, 3>{0, 9, 6}.data(), 2, results);
+
     /* DNR: Rectangle ret_all_2 = merge_all({Rectangle(2, 1),
                                      Rectangle(2, 1, {0, 1}),
                                      Rectangle(2, 2, {2, 0}),